@@ -35,9 +35,13 @@
 
 #include <array>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
+#include <streambuf>
 #include <type_traits>
+#include <vector>
 #include <string>
 #include <string_view>
 
@@ -85,6 +89,7 @@
 
 #if NANO_UNICODE_CPP_VERSION >= 202002L
   #define NANO_UNICODE_CPP_20
+  #include <ranges>
 
 namespace nano::unicode {
 template <class T>
@@ -108,6 +113,103 @@ namespace nano::unicode {
 ///
 enum class encoding { utf8 = sizeof(char), utf16 = sizeof(char16_t), utf32 = sizeof(char32_t) };
 
+///
+/// Kind of error found while validating or converting an ill-formed input.
+///
+enum class error_code {
+  none,
+
+  /// The input ended (or a sequence was interrupted) before a multi-unit sequence was complete.
+  truncated,
+
+  /// A utf8 continuation byte without a lead byte or a byte that can never appear in utf8.
+  invalid_lead,
+
+  /// A utf8 sequence that is longer than needed to encode its code point.
+  overlong,
+
+  /// An encoded or unpaired surrogate (U+D800 to U+DFFF).
+  surrogate,
+
+  /// A code point above U+10FFFF.
+  out_of_range
+};
+
+///
+/// The kind of error and the offset (in input code units) of the ill-formed sequence.
+///
+struct conversion_error {
+  error_code code = error_code::none;
+  std::size_t position = 0;
+
+  inline explicit operator bool() const noexcept { return code != error_code::none; }
+};
+
+///
+/// Converted output of a strict conversion.
+/// On error, value contains the conversion of everything before error.position.
+///
+template <typename CharT>
+struct conversion_result {
+  std::basic_string<CharT> value;
+  conversion_error error;
+
+  inline bool ok() const noexcept { return !error; }
+  inline explicit operator bool() const noexcept { return ok(); }
+};
+
+///
+/// Output iterator returned by a strict copy, along with the first error.
+///
+template <typename OutputIt>
+struct copy_result {
+  OutputIt out;
+  conversion_error error;
+
+  inline bool ok() const noexcept { return !error; }
+  inline explicit operator bool() const noexcept { return ok(); }
+};
+
+///
+/// Error policies.
+/// The converters, convert_as(), copy() and the iterators take one of these as a template
+/// parameter so that each instantiation only contains the checks it needs.
+///
+/// assume_valid: No checks at all, the input must be well-formed (the default).
+///               Ill-formed input gives unspecified (but memory safe) output.
+///
+/// replace:      Each maximal subpart of an ill-formed sequence is replaced with U+FFFD.
+///
+/// strict:       The conversion stops at the first ill-formed sequence and reports it.
+///               convert_as() returns a conversion_result and copy() a copy_result.
+///
+/// convert_as<CharT, Policy>() and copy<Policy>() are the entry points, convert_as_strict(),
+/// convert_as_lossy() and copy_lossy() are shorthands for them.
+///
+struct assume_valid {};
+struct replace {};
+struct strict {};
+
+///
+///
+///
+template <class Policy>
+struct is_error_policy : std::bool_constant<std::is_same<Policy, assume_valid>::value
+                             || std::is_same<Policy, replace>::value || std::is_same<Policy, strict>::value> {};
+
+///
+/// Return type of convert_as<CharT, Policy>().
+///
+template <class Policy, typename CharT>
+using convert_result_t
+    = std::conditional_t<std::is_same<Policy, strict>::value, conversion_result<CharT>, std::basic_string<CharT>>;
+
+///
+/// Return type of the converters and copy() for a given Policy.
+///
+template <class Policy, typename OutputIt>
+using copy_result_t = std::conditional_t<std::is_same<Policy, strict>::value, copy_result<OutputIt>, OutputIt>;
+
 ///
 ///
 ///
@@ -164,17 +266,51 @@ template <typename CharT, class SType,
 inline std::size_t convert_size(const SType& str);
 
 ///
+/// Converts str to a std::basic_string<CharT> with the given error policy.
+///
+/// strict validates and converts in a single pass, it stops at the first ill-formed sequence
+/// and reports its kind and position. replace substitutes U+FFFD for each maximal subpart of an
+/// ill-formed sequence (the WHATWG / Unicode "best practice" substitution).
+/// If replacements is not null, it receives the number of substitutions that were made.
+///
+template <typename CharT, class Policy = assume_valid, class SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value && is_error_policy<Policy>::value,
+        std::nullptr_t> = nullptr>
+inline convert_result_t<Policy, CharT> convert_as(const SType& str, std::size_t* replacements = nullptr);
+
 ///
+/// Same as convert_as<CharT, strict>().
 ///
 template <typename CharT, class SType,
     std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t> = nullptr>
-inline std::basic_string<CharT> convert_as(const SType& str);
+inline conversion_result<CharT> convert_as_strict(const SType& str);
 
 ///
+/// Same as convert_as<CharT, replace>().
+///
+template <typename CharT, class SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t> = nullptr>
+inline std::basic_string<CharT> convert_as_lossy(const SType& str, std::size_t* replacements = nullptr);
+
 ///
+/// Same as copy<replace>().
 ///
 template <class SType, class OutputIt, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
-inline OutputIt copy(const SType& str, OutputIt outputIt);
+inline OutputIt copy_lossy(const SType& str, OutputIt outputIt, std::size_t* replacements = nullptr);
+
+///
+/// Returns the first ill-formed sequence of str, or an empty conversion_error if str is valid.
+///
+template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
+inline conversion_error validate(const SType& str);
+
+///
+/// Converts str to outputIt with the given error policy, the output encoding is the one of
+/// the iterator value type. replacements is the same as in convert_as().
+///
+template <class Policy = assume_valid, class SType, class OutputIt,
+    std::enable_if_t<is_string_type<SType>::value && is_error_policy<Policy>::value, std::nullptr_t> = nullptr>
+inline copy_result_t<Policy, OutputIt> copy(const SType& str, OutputIt outputIt, std::size_t* replacements = nullptr);
 
 ///
 ///
@@ -191,31 +327,41 @@ class convert;
 ///
 ///
 ///
-template <typename CharT, typename SType>
+template <typename CharT, class Policy = assume_valid, typename SType>
 inline auto iterate_as(const SType& str);
 
 ///
 ///
 ///
-template <typename SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
+template <class Policy = assume_valid, typename SType,
+    std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
 inline auto iterate(const SType& str);
 
 ///
 ///
 ///
-template <class IteratorType>
+template <class IteratorType, class Policy = assume_valid>
 class iterator;
 
 ///
+/// With the replace policy, an ill-formed sequence is seen as a single U+FFFD.
+/// With the strict policy, it is seen as an empty element.
+/// In both cases the iterator moves past its maximal subpart.
 ///
+/// The iterator is bidirectional, and random access with a utf32 input.
+/// When CharT is of another encoding than the input (or for the U+FFFD of the replace policy),
+/// the dereferenced view points into the iterator itself. std::reverse_iterator can then not be used.
 ///
-template <class CharT, class SType, class IteratorType,
+template <class CharT, class SType, class IteratorType, class Policy = assume_valid,
     std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
 class basic_iterator;
 
 // Forward declared.
 class string_view;
 
+// Forward declared.
+class split_range;
+
 /// Converts any string type to a utf8 std::string.
 inline std::string to_utf8(string_view s);
 
@@ -268,6 +414,11 @@ inline std::wstring to_wide(string_view s);
  *     }
  *   }
  *
+ *   // Or with visit(), given a drawUtfText overload for each std::basic_string_view.
+ *   void drawText(nano::unicode::string_view text) {
+ *     text.visit([](auto str) { drawUtfText(str); });
+ *   }
+ *
  *   #ifdef _WIN32
  *   void setTextWindows(const std::wstring&) { ... }
  *   #else
@@ -344,19 +495,24 @@ public:
   string_view& operator=(const string_view&) noexcept = default;
 
   /// Indicates if the character array is null terminated.
-  inline bool null_terminated() const noexcept { return m_nullTerminated; }
+  inline bool null_terminated() const noexcept { return m_bits & k_null_terminated_flag; }
 
   /// Returns true if the character array contains no characters.
-  inline bool empty() const noexcept { return !m_size; }
+  inline bool empty() const noexcept { return size() == 0; }
 
   /// Returns the number of characters.
-  inline std::size_t size() const noexcept { return static_cast<std::size_t>(m_size); }
+  inline std::size_t size() const noexcept { return unpack_size(m_bits); }
+
+  /// Returns the largest number of characters a string_view can hold (2^59 - 1 on 64-bit targets).
+  static constexpr std::size_t max_size() noexcept {
+    return static_cast<std::size_t>((std::min)(std::uint64_t(~std::size_t(0)), ~std::uint64_t(0) >> k_size_shift));
+  }
 
   /// Returns the size of a single char (i.e. sizeof(char_type)).
-  inline std::size_t char_size() const noexcept { return static_cast<std::size_t>(m_charSize); }
+  inline std::size_t char_size() const noexcept { return std::size_t(1) << (m_bits & k_char_size_mask); }
 
   /// Returns the size of the string in bytes (i.e. size() * char_size()).
-  inline std::size_t size_bytes() const noexcept { return m_size * char_size(); }
+  inline std::size_t size_bytes() const noexcept { return size() * char_size(); }
 
   /// Returns the human readable character count.
   inline std::size_t count() const;
@@ -364,6 +520,26 @@ public:
   /// Returns the encoding.
   inline enum encoding encoding() const noexcept;
 
+  /// Returns true if the content is known to be well-formed.
+  /// This is only known after a call to validate() or set_known_valid().
+  inline bool known_valid() const noexcept { return m_bits & k_valid_flag; }
+
+  /// Returns true if the content is known to only contain ascii characters.
+  /// This is only known after a call to validate() or set_known_ascii().
+  inline bool known_ascii() const noexcept { return m_bits & k_ascii_flag; }
+
+  /// Tells the view that its content is well-formed.
+  /// Conversions and validate() can then skip their checks.
+  inline string_view& set_known_valid() noexcept;
+
+  /// Tells the view that its content only contains ascii characters (which implies well-formed).
+  /// count() is then O(1) and conversions become a plain widening or narrowing copy.
+  inline string_view& set_known_ascii() noexcept;
+
+  /// Returns the first ill-formed sequence, or an empty conversion_error if the content is valid.
+  /// On success, the view remembers that it is valid and whether it only contains ascii characters.
+  inline conversion_error validate() noexcept;
+
   /// Returns a pointer to a null-terminated character array with data equivalent to those
   /// stored in the string. The pointer is such that the range [c_str(); c_str() + size()]
   /// is valid and the values in it correspond to the values stored in the string with an
@@ -467,6 +643,72 @@ public:
   /// Converts the character array to a std::wstring.
   inline std::wstring to_wide() const;
 
+  /// Same as to_utf8() but ill-formed sequences are replaced with U+FFFD.
+  /// If replacements is not null, it receives the number of substitutions that were made.
+  inline std::string to_utf8_lossy(std::size_t* replacements = nullptr) const;
+
+  /// Same as to_utf16() but ill-formed sequences are replaced with U+FFFD.
+  inline std::u16string to_utf16_lossy(std::size_t* replacements = nullptr) const;
+
+  /// Same as to_utf32() but ill-formed sequences are replaced with U+FFFD.
+  inline std::u32string to_utf32_lossy(std::size_t* replacements = nullptr) const;
+
+  /// Same as to_wide() but ill-formed sequences are replaced with U+FFFD.
+  inline std::wstring to_wide_lossy(std::size_t* replacements = nullptr) const;
+
+  /// Compares two strings in code point order, whatever their encodings are.
+  /// Returns a negative value, zero or a positive value if this string is less than, equal to or greater than other.
+  /// Each code unit of an ill-formed sequence compares above U+10FFFF, by encoding and then by value,
+  /// so that the order agrees with operator== and stays a strict weak ordering on any input.
+  inline int compare(const string_view& other) const noexcept;
+
+  /// Calls f with a std::basic_string_view<char>, std::basic_string_view<char16_t> or
+  /// std::basic_string_view<char32_t> of the content, depending on the encoding.
+  /// f is instantiated for each encoding and must return the same type for all of them.
+  template <class Fct>
+  inline decltype(auto) visit(Fct&& f) const;
+
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  /// Returns the code unit offset of the first occurrence of needle at or after the code unit offset pos, or npos.
+  /// The needle can be of any encoding, it is converted to the encoding of this string first.
+  /// Only matches that start and end on code point boundaries are reported.
+  inline std::size_t find(const string_view& needle, std::size_t pos = 0) const;
+
+  /// Same as find() but returns the last occurrence starting at or before the code unit offset pos.
+  inline std::size_t rfind(const string_view& needle, std::size_t pos = npos) const;
+
+  /// Returns true if needle (of any encoding) is found in this string.
+  inline bool contains(const string_view& needle) const { return find(needle) != npos; }
+
+  /// Returns true if this string starts with prefix (of any encoding).
+  inline bool starts_with(const string_view& prefix) const;
+
+  /// Returns true if this string ends with suffix (of any encoding).
+  inline bool ends_with(const string_view& suffix) const;
+
+  /// Returns a lazy range of the pieces between each occurrence of delimiter ("a,,b" gives "a", "" and "b").
+  inline split_range split(char32_t delimiter) const noexcept;
+
+  /// Returns a lazy range of the lines, separated by LF, CR, CRLF, LS (U+2028) or PS (U+2029).
+  /// A line break at the very end does not start an extra empty line.
+  inline split_range lines() const noexcept;
+
+  /// Returns a lazy range of the pieces between any of the code points of delimiters (of any encoding).
+  /// The content of delimiters must outlive the range.
+  inline split_range split_any(const string_view& delimiters) const noexcept;
+
+  /// Equal when both strings have the same code points, whatever their encodings are.
+  /// An ill-formed sequence is only equal to the same code units in the same encoding, so that
+  /// equality stays transitive and equal strings have the same hash().
+  inline friend bool operator==(const string_view& a, const string_view& b) noexcept;
+
+  inline friend bool operator!=(const string_view& a, const string_view& b) noexcept { return !(a == b); }
+  inline friend bool operator<(const string_view& a, const string_view& b) noexcept { return a.compare(b) < 0; }
+  inline friend bool operator<=(const string_view& a, const string_view& b) noexcept { return a.compare(b) <= 0; }
+  inline friend bool operator>(const string_view& a, const string_view& b) noexcept { return a.compare(b) > 0; }
+  inline friend bool operator>=(const string_view& a, const string_view& b) noexcept { return a.compare(b) >= 0; }
+
 private:
   union content {
     inline content() noexcept;
@@ -482,10 +724,24 @@ private:
     const char32_t* c32;
   } m_data;
 
-  std::uint32_t m_size;
-  int m_charSize;
-  bool m_nullTerminated;
-  char m_reserved[7];
+  // Packed as [size:59][ascii:1][valid:1][null_terminated:1][log2(char_size):2],
+  // so that the whole view fits in two registers.
+  std::uint64_t m_bits;
+
+  static constexpr std::uint64_t k_char_size_mask = 0x3;
+  static constexpr std::uint64_t k_null_terminated_flag = 1 << 2;
+  static constexpr std::uint64_t k_valid_flag = 1 << 3;
+  static constexpr std::uint64_t k_ascii_flag = 1 << 4;
+  static constexpr int k_size_shift = 5;
+
+  static constexpr std::uint64_t pack(std::size_t size, std::size_t charSize, bool nullTerminated) noexcept {
+    return (static_cast<std::uint64_t>(size) << k_size_shift) | (nullTerminated ? k_null_terminated_flag : 0)
+        | (charSize == 4 ? 2 : charSize == 2 ? 1 : 0);
+  }
+
+  static constexpr std::size_t unpack_size(std::uint64_t bits) noexcept {
+    return static_cast<std::size_t>(bits >> k_size_shift);
+  }
 
   struct normal_tag {};
 
@@ -508,1328 +764,4292 @@ private:
   inline string_view(std::wstring_view str, null_terminated_tag) noexcept;
 };
 
-//
-//
-//**********************************************************************************************
-// Implementation.
-//**********************************************************************************************
-//
-//
-//
+// A pointer and a 64-bit word, 16 bytes on 32-bit targets that align std::uint64_t to 8.
+static_assert(sizeof(string_view) <= 2 * sizeof(std::uint64_t), "string_view should fit in two registers");
 
-template <typename CharT>
-struct is_char_type : std::bool_constant<std::is_same<char, std::remove_cv_t<CharT>>::value //
-                          || std::is_same<char16_t, std::remove_cv_t<CharT>>::value //
-                          || std::is_same<char32_t, std::remove_cv_t<CharT>>::value //
-                          || std::is_same<wchar_t, std::remove_cv_t<CharT>>::value //
-#ifdef NANO_UNICODE_CPP_20
-                          || std::is_same<char8_t, std::remove_cv_t<CharT>>::value
-#endif
-                          > {
-};
+/// Calls f with the typed std::basic_string_view of both a and b (see string_view::visit()).
+/// f is instantiated for each of the nine pairs of encodings.
+template <class Fct>
+inline decltype(auto) visit(Fct&& f, const string_view& a, const string_view& b);
 
-template <class SType>
-struct is_string_type : std::bool_constant<std::is_constructible<std::string_view, SType>::value //
-                            || std::is_constructible<std::u16string_view, SType>::value //
-                            || std::is_constructible<std::u32string_view, SType>::value //
-                            || std::is_constructible<std::wstring_view, SType>::value //
-#ifdef NANO_UNICODE_CPP_20
-                            || std::is_constructible<std::u8string_view, SType>::value
-#endif
-                            > {
-};
+/// Returns a hash of the code points of a string.
+/// The same text hashes equally in any encoding (ill-formed sequences hash as U+FFFD).
+inline std::size_t hash(const string_view& s) noexcept;
 
-template <std::size_t CharSize>
-struct is_char_size {
-  static constexpr bool value
-      = CharSize == sizeof(char) || CharSize == sizeof(char16_t) || CharSize == sizeof(char32_t);
-};
+/// Transparent hash for unordered containers, works with any string type of any encoding.
+/// @code
+///   std::unordered_map<std::string, int, nano::unicode::hasher, nano::unicode::equal_to> map;
+///   auto it = map.find(u"key"); // No conversion with C++20 heterogeneous lookup.
+/// @endcode
+struct hasher {
+  using is_transparent = void;
 
-template <encoding Encoding>
-struct encoding_size {
-  static constexpr std::size_t value = static_cast<std::size_t>(Encoding);
+  inline std::size_t operator()(const string_view& s) const noexcept { return hash(s); }
 };
 
-template <encoding Encoding>
-struct encoding_to_max_char_count {
-  static constexpr std::size_t value = []() {
-    if constexpr (Encoding == encoding::utf8) {
-      return 4;
-    }
-    else if constexpr (Encoding == encoding::utf16) {
-      return 2;
-    }
-    else if constexpr (Encoding == encoding::utf32) {
-      return 1;
-    }
-  }();
-};
+/// Transparent equality for unordered containers (see hasher).
+struct equal_to {
+  using is_transparent = void;
 
-template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
-struct encoding_of {
-  static constexpr encoding value = []() {
-    if constexpr (sizeof(CharT) == sizeof(char)) {
-      return encoding::utf8;
-    }
-    else if constexpr (sizeof(CharT) == sizeof(char16_t)) {
-      return encoding::utf16;
-    }
-    else if constexpr (sizeof(CharT) == sizeof(char32_t)) {
-      return encoding::utf32;
-    }
-  }();
+  inline bool operator()(const string_view& a, const string_view& b) const noexcept { return a == b; }
 };
 
-template <class SType, typename>
-struct string_char_type {
-  using type = void;
-};
+///
+/// Side index of a string_view for random access by code point index.
+///
+/// The code unit offset of every stride-th code point is kept, so a lookup walks at most stride - 1
+/// code points and the index holds count() / stride offsets. The string_view content must outlive the index.
+/// Ill-formed sequences count as one code point per maximal subpart (see convert_as_lossy()).
+///
+/// @code
+///   nano::unicode::code_point_index index(text, 256);
+///   nano::unicode::string_view page = index.substr_cp(page_number * page_size, page_size);
+/// @endcode
+///
+class code_point_index {
+public:
+  static constexpr std::size_t default_stride = 64;
 
-template <class SType>
-struct string_char_type<SType,
-    std::enable_if_t<std::is_constructible<std::basic_string_view<char>, unicode::remove_cvref_t<SType>>::value>> {
-  using type = char;
-};
+  code_point_index() noexcept = default;
 
-#ifdef NANO_UNICODE_CPP_20
-template <class SType>
-struct string_char_type<SType,
-    std::enable_if_t<std::is_constructible<std::basic_string_view<char8_t>, unicode::remove_cvref_t<SType>>::value>> {
-  using type = char8_t;
-};
-#endif // NANO_UNICODE_CPP_20
+  inline explicit code_point_index(string_view str, std::size_t stride = default_stride);
 
-template <class SType>
-struct string_char_type<SType,
-    std::enable_if_t<std::is_constructible<std::basic_string_view<char16_t>, unicode::remove_cvref_t<SType>>::value>> {
-  using type = char16_t;
-};
+  /// Returns the indexed string.
+  inline string_view str() const noexcept { return m_str; }
 
-template <class SType>
-struct string_char_type<SType,
-    std::enable_if_t<std::is_constructible<std::basic_string_view<char32_t>, unicode::remove_cvref_t<SType>>::value>> {
-  using type = char32_t;
-};
+  /// Returns the number of code points between two breadcrumbs.
+  inline std::size_t stride() const noexcept { return m_stride; }
 
-template <class SType>
-struct string_char_type<SType,
-    std::enable_if_t<std::is_constructible<std::basic_string_view<wchar_t>, unicode::remove_cvref_t<SType>>::value>> {
-  using type = wchar_t;
+  /// Returns the number of code points in the string.
+  inline std::size_t count() const noexcept { return m_count; }
+
+  /// Returns the code unit offset of the code point at cp_index, or str().size() if cp_index >= count().
+  inline std::size_t offset(std::size_t cp_index) const noexcept;
+
+  /// Returns the code point at cp_index (U+FFFD for an ill-formed sequence), or 0 if cp_index >= count().
+  inline char32_t at(std::size_t cp_index) const noexcept;
+
+  /// Returns the view of the n code points starting at code point pos (clamped to count()).
+  inline string_view substr_cp(std::size_t pos, std::size_t n = std::string_view::npos) const noexcept;
+
+private:
+  string_view m_str;
+  std::size_t m_stride = default_stride;
+  std::size_t m_count = 0;
+  std::vector<std::size_t> m_offsets;
 };
 
-namespace detail {
-  template <class T>
-  struct output_iterator_traits : std::iterator_traits<T> {};
+///
+/// Lazy forward range of the pieces of a string_view between delimiters.
+/// See string_view::split(), string_view::lines() and string_view::split_any().
+///
+/// The pieces are string_view of the original content, nothing is allocated.
+/// The iterators refer to the range, which must outlive them.
+/// The delimiters are searched in the encoding of the string, by first looking for
+/// the first code unit of any delimiter (8 bytes at a time for utf8).
+///
+class split_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const string_view*;
+    using reference = string_view;
 
-  template <class OutputIt, class T>
-  struct output_iterator_traits<std::raw_storage_iterator<OutputIt, T>> : std::iterator<std::output_iterator_tag, T> {};
+    iterator() noexcept = default;
 
-  template <class Container>
-  struct output_iterator_traits<std::back_insert_iterator<Container>>
-      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+    inline string_view operator*() const noexcept;
 
-  template <class Container>
-  struct output_iterator_traits<std::front_insert_iterator<Container>>
-      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+    inline iterator& operator++() noexcept;
 
-  template <class Container>
-  struct output_iterator_traits<std::insert_iterator<Container>>
-      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
 
-  template <class T, class charT, class traits>
-  struct output_iterator_traits<std::ostream_iterator<T, charT, traits>> : std::iterator<std::output_iterator_tag, T> {
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.m_pos == b.m_pos; }
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a.m_pos != b.m_pos; }
+
+  private:
+    friend class split_range;
+
+    inline iterator(const split_range* range, std::size_t pos) noexcept;
+
+    inline void find_end() noexcept;
+
+    const split_range* m_range = nullptr;
+    std::size_t m_pos = std::string_view::npos;
+    std::size_t m_end = std::string_view::npos;
+    std::size_t m_next = std::string_view::npos;
   };
 
-  template <class charT, class traits>
-  struct output_iterator_traits<std::ostreambuf_iterator<charT, traits>>
-      : std::iterator<std::output_iterator_tag, charT> {};
+  inline iterator begin() const noexcept;
+  inline iterator end() const noexcept { return iterator(); }
 
-  template <class T>
-  using output_iterator_value_type_t = typename output_iterator_traits<T>::value_type;
+private:
+  friend class string_view;
 
-} // namespace detail.
+  enum class mode { code_point, lines, any };
 
-namespace detail {
-  inline constexpr const std::uint16_t k_lead_surrogate_min = 0xD800u;
-  inline constexpr const std::uint16_t k_lead_offset = k_lead_surrogate_min - (0x10000 >> 10);
-  inline constexpr const std::uint16_t k_trail_surrogate_min = 0xDC00u;
+  inline split_range(string_view str, mode m, char32_t delimiter, string_view delimiters) noexcept;
 
-  /// Maximum valid value for a Unicode code point.
-  inline constexpr const std::uint32_t k_code_point_max = 0x0010FFFFu;
-  inline constexpr const std::uint32_t k_surrogate_offset
-      = 0x10000u - (k_lead_surrogate_min << 10) - k_trail_surrogate_min;
+  inline void add_delimiter(std::uint32_t cp) noexcept;
 
-  inline constexpr const std::uint8_t bom[] = { 0xef, 0xbb, 0xbf };
+  inline bool is_delimiter(std::uint32_t cp) const noexcept;
 
-  template <typename u8char_type>
-  inline std::uint8_t cast_8(u8char_type c) noexcept {
-    return static_cast<std::uint8_t>(c);
-  }
+  /// Returns the code unit offset and size of the first delimiter at or after pos (npos if there is none).
+  inline std::pair<std::size_t, std::size_t> find_delimiter(std::size_t pos) const noexcept;
 
-  template <typename u16char_type>
-  inline std::uint16_t cast_16(u16char_type c) noexcept {
-    return static_cast<std::uint16_t>(c);
-  }
+  string_view m_str;
+  string_view m_delimiters;
+  mode m_mode;
+  char32_t m_delimiter;
 
-  template <typename u8char_type>
-  inline bool is_trail(u8char_type c) {
-    return (cast_8(c) >> 6) == 0x2;
-  }
+  // First code unit of each delimiter, no filtering when m_unit_count is zero.
+  std::array<std::uint32_t, 8> m_units = {};
+  std::size_t m_unit_count = 0;
 
-  inline constexpr bool is_surrogate(char16_t uc) noexcept { return (uc - k_lead_surrogate_min) < 2048u; }
-  // inline constexpr bool is_surrogate(char16_t uc) noexcept { return (uc - 0xD800u) < 2048u; }
+  // Decoded delimiters of mode::any, m_delimiters is decoded on each lookup when there are more of them.
+  std::array<std::uint32_t, 16> m_code_points = {};
+  std::size_t m_code_point_count = 0;
+};
 
-  // Lead.
-  inline constexpr bool is_high_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == k_lead_surrogate_min; }
-  // inline constexpr bool is_high_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == 0xD800; }
+/// Returns the longest prefix of s that ends on a code point boundary and has at most max_units code units.
+inline string_view truncate_to_units(const string_view& s, std::size_t max_units) noexcept;
 
-  // Trail.
-  inline constexpr bool is_low_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == k_trail_surrogate_min; }
-  // inline constexpr bool is_low_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == 0xDC00; }
+/// Returns the longest prefix of s that ends on a code point boundary and needs at most max_units
+/// code units once converted to the target encoding (ill-formed sequences count as U+FFFD).
+inline string_view truncate_to_units(const string_view& s, std::size_t max_units, encoding target) noexcept;
+
+///
+/// Lazy forward range of consecutive pieces of a string_view, each of them being
+/// the truncate_to_units() of what is left.
+///
+/// A code point that doesn't fit in max_units by itself is yielded alone.
+///
+class chunk_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const string_view*;
+    using reference = string_view;
+
+    iterator() noexcept = default;
+
+    inline iterator(string_view str, std::size_t max_units, encoding target) noexcept;
+
+    inline string_view operator*() const noexcept { return m_chunk; }
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept {
+      return a.m_chunk.size() == b.m_chunk.size() && a.m_rest.size() == b.m_rest.size();
+    }
+
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return !(a == b); }
+
+  private:
+    string_view m_chunk;
+    string_view m_rest;
+    std::size_t m_max_units = 0;
+    encoding m_target = encoding::utf8;
+  };
+
+  inline chunk_range(string_view str, std::size_t max_units, encoding target) noexcept
+      : m_str(str)
+      , m_max_units(max_units)
+      , m_target(target) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str, m_max_units, m_target); }
+  inline iterator end() const noexcept { return iterator(); }
+
+private:
+  string_view m_str;
+  std::size_t m_max_units;
+  encoding m_target;
+};
+
+/// Splits s in pieces of at most max_units code units, cut on code point boundaries.
+/// @code
+///   for (nano::unicode::string_view message : nano::unicode::chunks(text, 512)) {
+///     send(message);
+///   }
+/// @endcode
+inline chunk_range chunks(const string_view& s, std::size_t max_units) noexcept;
+
+/// Splits s in pieces that need at most max_units code units once converted to the target encoding.
+inline chunk_range chunks(const string_view& s, std::size_t max_units, encoding target) noexcept;
+
+///
+/// Range of the code points of a std::basic_string_view<CharT>, see code_points().
+///
+/// Each step decodes exactly once into a cached char32_t (U+FFFD for an ill-formed sequence).
+///
+template <typename CharT>
+class basic_code_point_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char32_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char32_t*;
+    using reference = char32_t;
+
+    iterator() noexcept = default;
+
+    inline char32_t operator*() const noexcept { return m_cp; }
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    /// Returns the position of the current code point in the input.
+    inline const CharT* base() const noexcept { return m_it; }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.m_it == b.m_it; }
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a.m_it != b.m_it; }
+
+  private:
+    friend class basic_code_point_range;
+
+    inline iterator(const CharT* it, const CharT* end) noexcept;
+
+    const CharT* m_it = nullptr;
+    const CharT* m_next = nullptr;
+    const CharT* m_end = nullptr;
+    char32_t m_cp = 0;
+  };
+
+  inline explicit basic_code_point_range(std::basic_string_view<CharT> str) noexcept
+      : m_str(str) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str.data(), m_str.data() + m_str.size()); }
+  inline iterator end() const noexcept { return iterator(m_str.data() + m_str.size(), m_str.data() + m_str.size()); }
+
+private:
+  std::basic_string_view<CharT> m_str;
+};
+
+///
+/// Range of the code points of a string_view of any encoding, see code_points().
+///
+/// Each step decodes exactly once into a cached char32_t (U+FFFD for an ill-formed sequence).
+/// Use string_view::visit() with the basic_code_point_range overload to avoid switching
+/// on the encoding at every step.
+///
+class code_point_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char32_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char32_t*;
+    using reference = char32_t;
+
+    iterator() noexcept = default;
+
+    inline char32_t operator*() const noexcept { return m_cp; }
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    /// Returns the code unit offset of the current code point.
+    inline std::size_t offset() const noexcept { return m_pos; }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.m_pos == b.m_pos; }
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a.m_pos != b.m_pos; }
+
+  private:
+    friend class code_point_range;
+
+    inline iterator(string_view str, std::size_t pos) noexcept;
+
+    inline void decode() noexcept;
+
+    string_view m_str;
+    std::size_t m_pos = 0;
+    std::size_t m_next = 0;
+    char32_t m_cp = 0;
+  };
+
+  inline explicit code_point_range(string_view str) noexcept
+      : m_str(str) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str, 0); }
+  inline iterator end() const noexcept { return iterator(m_str, m_str.size()); }
+
+private:
+  string_view m_str;
+};
+
+/// Returns the range of the code points of any string type.
+/// The range doesn't own the characters, str must outlive it.
+/// @code
+///   for (char32_t c : nano::unicode::code_points(text)) {
+///     ...
+///   }
+/// @endcode
+template <typename SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t> = nullptr>
+inline basic_code_point_range<string_char_type_t<SType>> code_points(const SType& str) noexcept;
+
+/// Returns the range of the code points of a string_view.
+inline code_point_range code_points(const string_view& str) noexcept;
+
+///
+/// Single pass range of blocks of decoded code points, see decode_blocks().
+///
+/// The block buffer lives in the range: the range must outlive its iterators
+/// and a block is overwritten when the iterator moves to the next one.
+///
+template <typename CharT>
+class block_range {
+public:
+  static_assert(is_char_type<CharT>::value, "The block character type must be a char type.");
+
+  /// Maximum number of code points in a block.
+  static constexpr std::size_t max_block_size = 64;
+
+  class block {
+  public:
+    /// Returns the code units of the decoded code points.
+    inline std::basic_string_view<CharT> units() const noexcept { return { m_units, m_unit_count }; }
+
+    /// Returns the number of code points in the block.
+    inline std::size_t size() const noexcept { return m_size; }
+
+    /// Returns the offset in the source of the i-th code point.
+    /// offset(size()) is the offset of the end of the block.
+    inline std::size_t offset(std::size_t i) const noexcept { return m_offsets[i]; }
+
+    /// Returns the size() + 1 source offsets.
+    inline const std::size_t* offsets() const noexcept { return m_offsets; }
+
+  private:
+    friend class block_range;
+
+    alignas(64) CharT m_units[max_block_size * encoding_to_max_char_count<encoding_of<CharT>::value>::value];
+    std::size_t m_offsets[max_block_size + 1] = { 0 };
+    std::size_t m_unit_count = 0;
+    std::size_t m_size = 0;
+  };
+
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = block;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const block*;
+    using reference = const block&;
+
+    iterator() noexcept = default;
+
+    inline const block& operator*() const noexcept { return m_range->m_block; }
+    inline const block* operator->() const noexcept { return &m_range->m_block; }
+
+    inline iterator& operator++() noexcept {
+      m_pos = m_range->m_block.offset(m_range->m_block.size());
+      m_range->decode(m_pos);
+      return *this;
+    }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.m_pos == b.m_pos; }
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a.m_pos != b.m_pos; }
+
+  private:
+    friend class block_range;
+
+    inline iterator(block_range* range, std::size_t pos) noexcept
+        : m_range(range)
+        , m_pos(pos) {}
+
+    block_range* m_range = nullptr;
+    std::size_t m_pos = 0;
+  };
+
+  inline block_range(string_view str, std::size_t block_size) noexcept
+      : m_str(str)
+      , m_block_size((std::min)((std::max)(block_size, std::size_t(1)), max_block_size)) {}
+
+  /// Decodes the first block, calling begin() again restarts from the beginning.
+  inline iterator begin() noexcept {
+    decode(0);
+    return iterator(this, 0);
+  }
+
+  inline iterator end() noexcept { return iterator(this, m_str.size()); }
+
+private:
+  string_view m_str;
+  std::size_t m_block_size;
+  block m_block;
+
+  inline void decode(std::size_t pos) noexcept;
+};
+
+/// Decodes s in blocks of up to block_size code points (at most 64) converted to CharT.
+/// Each block gives the decoded code units and the source offset of every code point,
+/// so the consumer can run its own loop over a batch instead of stepping an iterator.
+/// @code
+///   for (const auto& b : nano::unicode::decode_blocks<char32_t>(text, 64)) {
+///     classify(b.units().data(), b.size());
+///   }
+/// @endcode
+template <typename CharT = char32_t>
+inline block_range<CharT> decode_blocks(const string_view& s, std::size_t block_size = 64) noexcept;
+
+///
+/// Converts a stream of From code units received in chunks of any size to To.
+///
+/// A sequence split between two chunks is kept (at most 3 code units) until the next feed()
+/// completes it. Ill-formed sequences are replaced with U+FFFD as in convert_as_lossy(),
+/// and finish() replaces a sequence that is still incomplete at the end of the stream.
+///
+/// @code
+///   nano::unicode::transcoder<char, char16_t> decoder;
+///   std::u16string text;
+///
+///   while (read(socket, buffer)) {
+///     decoder.feed(buffer, std::back_inserter(text));
+///   }
+///
+///   decoder.finish(std::back_inserter(text));
+/// @endcode
+///
+template <typename From, typename To>
+class transcoder {
+public:
+  static_assert(is_char_type<From>::value && is_char_type<To>::value, "From and To must be char types.");
+
+  /// Converts chunk to outputIt, except for a trailing incomplete sequence that is kept for the next call.
+  template <class OutputIt>
+  inline OutputIt feed(std::basic_string_view<From> chunk, OutputIt outputIt);
+
+  /// Ends the stream, a sequence left incomplete by feed() is written as U+FFFD.
+  template <class OutputIt>
+  inline OutputIt finish(OutputIt outputIt);
+
+  /// Returns the number of code units kept for the next feed().
+  inline std::size_t pending() const noexcept { return m_pending_size; }
+
+  /// Returns the number of U+FFFD substitutions so far.
+  inline std::size_t replacements() const noexcept { return m_replacements; }
+
+  /// Drops the pending code units and the substitution count to start a new stream.
+  inline void reset() noexcept {
+    m_pending_size = 0;
+    m_replacements = 0;
+  }
+
+private:
+  static constexpr std::size_t max_pending = encoding_to_max_char_count<encoding_of<From>::value>::value - 1;
+
+  std::array<From, max_pending> m_pending = {};
+  std::size_t m_pending_size = 0;
+  std::size_t m_replacements = 0;
+};
+
+///
+/// A stream buffer of From characters over a target std::streambuf holding To code units.
+///
+/// Writes are gathered in blocks, converted to To and sent downstream with a single sputn()
+/// per block. Reads pull blocks of To code units from the target and convert them to From.
+/// Code units wider than a byte are stored in native byte order, and ill-formed input is
+/// replaced with U+FFFD in both directions.
+///
+/// @code
+///   // Writes wide text to stdout as utf8.
+///   nano::unicode::transcoding_streambuf<wchar_t, char> buffer(std::cout.rdbuf());
+///   std::wostream wlog(&buffer);
+///   wlog << L"Grüße" << std::endl;
+///
+///   // Reads a utf16 file as utf8.
+///   std::filebuf file;
+///   file.open("text.txt", std::ios::in | std::ios::binary);
+///   nano::unicode::transcoding_streambuf<char, char16_t> reader(&file);
+///   std::istream input(&reader);
+/// @endcode
+///
+template <typename From, typename To>
+class transcoding_streambuf : public std::basic_streambuf<From> {
+public:
+  using char_type = From;
+  using traits_type = std::char_traits<From>;
+  using int_type = typename traits_type::int_type;
+
+  /// Number of From characters buffered before a block is converted.
+  static constexpr std::size_t block_size = 1024;
+
+  inline explicit transcoding_streambuf(std::streambuf* target) noexcept;
+
+  transcoding_streambuf(const transcoding_streambuf&) = delete;
+  transcoding_streambuf& operator=(const transcoding_streambuf&) = delete;
+
+  /// Flushes the pending output, a sequence left incomplete is written as U+FFFD.
+  inline ~transcoding_streambuf() override;
+
+  inline std::streambuf* target() const noexcept { return m_target; }
+
+  /// Returns the number of U+FFFD substitutions in both directions.
+  inline std::size_t replacements() const noexcept {
+    return m_encoder.replacements() + m_decoder.replacements() + m_partial_units;
+  }
+
+protected:
+  inline int_type overflow(int_type c) override;
+  inline int sync() override;
+  inline int_type underflow() override;
+
+private:
+  static constexpr std::size_t max_to_count = encoding_to_max_char_count<encoding_of<To>::value>::value;
+  static constexpr std::size_t max_from_count = encoding_to_max_char_count<encoding_of<From>::value>::value;
+
+  std::streambuf* m_target;
+  transcoder<From, To> m_encoder;
+  transcoder<To, From> m_decoder;
+
+  // Each input code unit gives at most max_count output units, plus a code point for the pending units.
+  std::array<From, block_size> m_put;
+  std::array<To, (block_size + 1) * max_to_count> m_put_converted;
+  std::array<char, block_size * sizeof(To)> m_get_raw;
+  std::array<From, (block_size + 1) * max_from_count> m_get;
+  std::size_t m_get_raw_size = 0;
+  std::size_t m_partial_units = 0;
+  bool m_get_eof = false;
+
+  inline bool flush_put_area();
+  inline bool write_converted(const To* last);
+};
+
+///
+/// Encoding of a byte buffer, as found by detect_encoding().
+///
+struct encoding_detection {
+  enum encoding encoding = encoding::utf8;
+
+  /// True when the utf16 or utf32 code units are big endian.
+  bool big_endian = false;
+
+  /// True when the bytes start with a byte order mark.
+  bool has_bom = false;
+
+  /// 1 when a byte order mark was found, down to 0 for a blind guess (e.g. empty input).
+  float confidence = 0;
+
+  /// The bytes after the byte order mark.
+  std::string_view bytes;
+
+  /// The bytes after the byte order mark seen as the detected encoding, nothing is copied.
+  /// Empty when the code units aren't in native byte order or the bytes aren't aligned for them.
+  string_view payload;
+};
+
+///
+/// Finds the encoding of bytes of unknown origin: utf8, utf16 or utf32 in either byte order.
+///
+/// A byte order mark decides alone. Otherwise the zero bytes of the first 4096 bytes are counted
+/// by position, which tells utf32 (two zero bytes per unit) and utf16 (zeros on one parity) apart
+/// once the code units are validated. Other prefixes are validated as utf8, and as utf16 without
+/// zero bytes (e.g. CJK text) when they aren't utf8.
+///
+inline encoding_detection detect_encoding(std::string_view bytes) noexcept;
+
+//
+//
+//**********************************************************************************************
+// Implementation.
+//**********************************************************************************************
+//
+//
+//
+
+template <typename CharT>
+struct is_char_type : std::bool_constant<std::is_same<char, std::remove_cv_t<CharT>>::value //
+                          || std::is_same<char16_t, std::remove_cv_t<CharT>>::value //
+                          || std::is_same<char32_t, std::remove_cv_t<CharT>>::value //
+                          || std::is_same<wchar_t, std::remove_cv_t<CharT>>::value //
+#ifdef NANO_UNICODE_CPP_20
+                          || std::is_same<char8_t, std::remove_cv_t<CharT>>::value
+#endif
+                          > {
+};
+
+template <class SType>
+struct is_string_type : std::bool_constant<std::is_constructible<std::string_view, SType>::value //
+                            || std::is_constructible<std::u16string_view, SType>::value //
+                            || std::is_constructible<std::u32string_view, SType>::value //
+                            || std::is_constructible<std::wstring_view, SType>::value //
+#ifdef NANO_UNICODE_CPP_20
+                            || std::is_constructible<std::u8string_view, SType>::value
+#endif
+                            > {
+};
+
+template <std::size_t CharSize>
+struct is_char_size {
+  static constexpr bool value
+      = CharSize == sizeof(char) || CharSize == sizeof(char16_t) || CharSize == sizeof(char32_t);
+};
+
+template <encoding Encoding>
+struct encoding_size {
+  static constexpr std::size_t value = static_cast<std::size_t>(Encoding);
+};
+
+template <encoding Encoding>
+struct encoding_to_max_char_count {
+  static constexpr std::size_t value = []() {
+    if constexpr (Encoding == encoding::utf8) {
+      return 4;
+    }
+    else if constexpr (Encoding == encoding::utf16) {
+      return 2;
+    }
+    else if constexpr (Encoding == encoding::utf32) {
+      return 1;
+    }
+  }();
+};
+
+template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
+struct encoding_of {
+  static constexpr encoding value = []() {
+    if constexpr (sizeof(CharT) == sizeof(char)) {
+      return encoding::utf8;
+    }
+    else if constexpr (sizeof(CharT) == sizeof(char16_t)) {
+      return encoding::utf16;
+    }
+    else if constexpr (sizeof(CharT) == sizeof(char32_t)) {
+      return encoding::utf32;
+    }
+  }();
+};
+
+template <class SType, typename>
+struct string_char_type {
+  using type = void;
+};
+
+template <class SType>
+struct string_char_type<SType,
+    std::enable_if_t<std::is_constructible<std::basic_string_view<char>, unicode::remove_cvref_t<SType>>::value>> {
+  using type = char;
+};
+
+#ifdef NANO_UNICODE_CPP_20
+template <class SType>
+struct string_char_type<SType,
+    std::enable_if_t<std::is_constructible<std::basic_string_view<char8_t>, unicode::remove_cvref_t<SType>>::value>> {
+  using type = char8_t;
+};
+#endif // NANO_UNICODE_CPP_20
+
+template <class SType>
+struct string_char_type<SType,
+    std::enable_if_t<std::is_constructible<std::basic_string_view<char16_t>, unicode::remove_cvref_t<SType>>::value>> {
+  using type = char16_t;
+};
+
+template <class SType>
+struct string_char_type<SType,
+    std::enable_if_t<std::is_constructible<std::basic_string_view<char32_t>, unicode::remove_cvref_t<SType>>::value>> {
+  using type = char32_t;
+};
+
+template <class SType>
+struct string_char_type<SType,
+    std::enable_if_t<std::is_constructible<std::basic_string_view<wchar_t>, unicode::remove_cvref_t<SType>>::value>> {
+  using type = wchar_t;
+};
+
+namespace detail {
+  template <class T>
+  struct output_iterator_traits : std::iterator_traits<T> {};
+
+  template <class OutputIt, class T>
+  struct output_iterator_traits<std::raw_storage_iterator<OutputIt, T>> : std::iterator<std::output_iterator_tag, T> {};
+
+  template <class Container>
+  struct output_iterator_traits<std::back_insert_iterator<Container>>
+      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+
+  template <class Container>
+  struct output_iterator_traits<std::front_insert_iterator<Container>>
+      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+
+  template <class Container>
+  struct output_iterator_traits<std::insert_iterator<Container>>
+      : std::iterator<std::output_iterator_tag, typename Container::value_type> {};
+
+  template <class T, class charT, class traits>
+  struct output_iterator_traits<std::ostream_iterator<T, charT, traits>> : std::iterator<std::output_iterator_tag, T> {
+  };
+
+  template <class charT, class traits>
+  struct output_iterator_traits<std::ostreambuf_iterator<charT, traits>>
+      : std::iterator<std::output_iterator_tag, charT> {};
+
+  template <class T>
+  using output_iterator_value_type_t = typename output_iterator_traits<T>::value_type;
+
+} // namespace detail.
+
+namespace detail {
+  inline constexpr const std::uint16_t k_lead_surrogate_min = 0xD800u;
+  inline constexpr const std::uint16_t k_lead_offset = k_lead_surrogate_min - (0x10000 >> 10);
+  inline constexpr const std::uint16_t k_trail_surrogate_min = 0xDC00u;
+
+  /// Maximum valid value for a Unicode code point.
+  inline constexpr const std::uint32_t k_code_point_max = 0x0010FFFFu;
+  inline constexpr const std::uint32_t k_surrogate_offset
+      = 0x10000u - (k_lead_surrogate_min << 10) - k_trail_surrogate_min;
+
+  inline constexpr const std::uint8_t bom[] = { 0xef, 0xbb, 0xbf };
+
+  /// U+FFFD, substituted for ill-formed sequences by the lossy conversions.
+  inline constexpr const std::uint32_t k_replacement_character = 0xFFFDu;
+
+  template <typename u8char_type>
+  inline constexpr std::uint8_t cast_8(u8char_type c) noexcept {
+    return static_cast<std::uint8_t>(c);
+  }
+
+  template <typename u16char_type>
+  inline constexpr std::uint16_t cast_16(u16char_type c) noexcept {
+    return static_cast<std::uint16_t>(c);
+  }
+
+  template <typename u8char_type>
+  inline constexpr bool is_trail(u8char_type c) {
+    return (cast_8(c) >> 6) == 0x2;
+  }
+
+  inline constexpr bool is_surrogate(char16_t uc) noexcept { return (uc - k_lead_surrogate_min) < 2048u; }
+  // inline constexpr bool is_surrogate(char16_t uc) noexcept { return (uc - 0xD800u) < 2048u; }
+
+  // Lead.
+  inline constexpr bool is_high_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == k_lead_surrogate_min; }
+  // inline constexpr bool is_high_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == 0xD800; }
+
+  // Trail.
+  inline constexpr bool is_low_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == k_trail_surrogate_min; }
+  // inline constexpr bool is_low_surrogate(char16_t uc) noexcept { return (uc & 0xFFFFFC00) == 0xDC00; }
 
   template <typename u32char_type>
   inline constexpr bool is_valid_code_point(u32char_type cp) noexcept {
     return cp <= k_code_point_max && !is_surrogate(cp);
   }
 
-  inline constexpr std::size_t sequence_length(std::uint8_t lead) noexcept {
-    return lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+  inline constexpr std::size_t sequence_length(std::uint8_t lead) noexcept {
+    return lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+  }
+
+  inline constexpr std::size_t u16_sequence_length(char16_t c) noexcept { return is_high_surrogate(c) ? 2 : 1; }
+
+  template <typename u8_iterator>
+  inline constexpr bool starts_with_bom(u8_iterator it, u8_iterator end) noexcept {
+    return (((it != end) && (cast_8(*it++)) == bom[0]) && ((it != end) && (cast_8(*it++)) == bom[1])
+        && ((it != end) && (cast_8(*it)) == bom[2]));
+  }
+
+  /// Decodes one utf8 sequence at it and checks it against the well-formed byte
+  /// sequences of the Unicode standard (Table 3-7).
+  /// On error, it is left past the maximal subpart of the ill-formed sequence
+  /// (always at least one byte) and cp is undefined.
+  template <typename u8_iterator>
+  inline constexpr error_code decode_u8(u8_iterator& it, u8_iterator end, std::uint32_t& cp) noexcept {
+    const std::uint8_t lead = cast_8(*it++);
+
+    if (lead < 0x80) {
+      cp = lead;
+      return error_code::none;
+    }
+
+    std::size_t length = 0;
+    std::uint8_t lower = 0x80;
+    std::uint8_t upper = 0xBF;
+    error_code bounds_error = error_code::none;
+
+    if (lead < 0xC2) {
+      return lead < 0xC0 ? error_code::invalid_lead : error_code::overlong;
+    }
+    else if (lead < 0xE0) {
+      length = 2;
+      cp = lead & 0x1Fu;
+    }
+    else if (lead < 0xF0) {
+      length = 3;
+      cp = lead & 0x0Fu;
+
+      if (lead == 0xE0) {
+        lower = 0xA0;
+        bounds_error = error_code::overlong;
+      }
+      else if (lead == 0xED) {
+        upper = 0x9F;
+        bounds_error = error_code::surrogate;
+      }
+    }
+    else if (lead < 0xF5) {
+      length = 4;
+      cp = lead & 0x07u;
+
+      if (lead == 0xF0) {
+        lower = 0x90;
+        bounds_error = error_code::overlong;
+      }
+      else if (lead == 0xF4) {
+        upper = 0x8F;
+        bounds_error = error_code::out_of_range;
+      }
+    }
+    else {
+      return lead < 0xF8 ? error_code::out_of_range : error_code::invalid_lead;
+    }
+
+    if (it == end) {
+      return error_code::truncated;
+    }
+
+    std::uint8_t c = cast_8(*it);
+    if (c < lower || c > upper) {
+      return is_trail(c) ? bounds_error : error_code::truncated;
+    }
+
+    ++it;
+    cp = (cp << 6) | (c & 0x3Fu);
+
+    for (std::size_t i = 2; i < length; i++) {
+      if (it == end || !is_trail(c = cast_8(*it))) {
+        return error_code::truncated;
+      }
+
+      ++it;
+      cp = (cp << 6) | (c & 0x3Fu);
+    }
+
+    return error_code::none;
+  }
+
+  /// Decodes one utf16 code point at it.
+  /// On error, it is left past the unpaired surrogate and cp is undefined.
+  template <typename u16_iterator>
+  inline error_code decode_u16(u16_iterator& it, u16_iterator end, std::uint32_t& cp) noexcept {
+    cp = cast_16(*it++);
+
+    if (!is_surrogate(static_cast<char16_t>(cp))) {
+      return error_code::none;
+    }
+
+    if (!is_high_surrogate(static_cast<char16_t>(cp))) {
+      return error_code::surrogate;
+    }
+
+    if (it == end) {
+      return error_code::truncated;
+    }
+
+    const std::uint16_t trail = cast_16(*it);
+    if (!is_low_surrogate(static_cast<char16_t>(trail))) {
+      return error_code::surrogate;
+    }
+
+    ++it;
+    cp = (cp << 10) + trail + k_surrogate_offset;
+    return error_code::none;
+  }
+
+  inline constexpr error_code check_u32(std::uint32_t cp) noexcept {
+    return cp > k_code_point_max ? error_code::out_of_range
+        : (cp >= k_lead_surrogate_min && cp <= 0xDFFFu) ? error_code::surrogate
+                                                        : error_code::none;
+  }
+
+  /// Mask of the bits that must be zero in every code unit of a 64-bit word
+  /// for all the code units it contains to be ascii.
+  template <std::size_t CharSize>
+  inline constexpr std::uint64_t k_ascii_word_mask = CharSize == 1 ? 0x8080808080808080ull
+      : CharSize == 2                                            ? 0xFF80FF80FF80FF80ull
+                                                                 : 0xFFFFFF80FFFFFF80ull;
+
+  /// Returns the number of leading ascii code units in [str, str + size).
+  /// Works on 8 bytes at a time and never reads past str + size.
+  template <typename CharT>
+  inline std::size_t ascii_prefix_length(const CharT* str, std::size_t size) noexcept {
+    constexpr std::size_t word_size = sizeof(std::uint64_t) / sizeof(CharT);
+    constexpr std::uint64_t mask = k_ascii_word_mask<sizeof(CharT)>;
+
+    std::size_t i = 0;
+    for (; i + word_size <= size; i += word_size) {
+      std::uint64_t word;
+      std::memcpy(&word, str + i, sizeof(word));
+
+      if (word & mask) {
+        break;
+      }
+    }
+
+    while (i < size && static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<CharT>>(str[i])) < 0x80) {
+      i++;
+    }
+
+    return i;
+  }
+
+  /// Copies an ascii run of any char type to an output iterator of any char type.
+  template <typename CharT, typename OutputIt>
+  inline OutputIt copy_ascii(const CharT* first, const CharT* last, OutputIt outputIt) {
+    using ctype = output_iterator_value_type_t<OutputIt>;
+
+    for (; first != last; ++first) {
+      *outputIt++ = static_cast<ctype>(*first);
+    }
+
+    return outputIt;
+  }
+} // namespace detail.
+
+template <typename u8_iterator>
+inline constexpr u8_iterator append_u32_to_u8(std::uint32_t cp, u8_iterator it) {
+  using ctype = detail::output_iterator_value_type_t<u8_iterator>;
+
+  // 1 byte.
+  if (cp < 0x80) {
+    *it++ = static_cast<ctype>(cp);
+  }
+  // 2 bytes.
+  else if (cp < 0x800) {
+    *it++ = static_cast<ctype>((cp >> 6) | 0xC0);
+    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+  }
+  // 3 bytes.
+  else if (cp < 0x10000) {
+    *it++ = static_cast<ctype>((cp >> 12) | 0xE0);
+    *it++ = static_cast<ctype>(((cp >> 6) & 0x3F) | 0x80);
+    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+  }
+  // 4 bytes.
+  else {
+    *it++ = static_cast<ctype>((cp >> 18) | 0xF0);
+    *it++ = static_cast<ctype>(((cp >> 12) & 0x3F) | 0x80);
+    *it++ = static_cast<ctype>(((cp >> 6) & 0x3F) | 0x80);
+    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+  }
+
+  return it;
+}
+
+template <typename u16_iterator>
+inline constexpr u16_iterator append_u32_to_u16(std::uint32_t cp, u16_iterator it) {
+  using ctype = detail::output_iterator_value_type_t<u16_iterator>;
+
+  if (cp > 0xFFFF) { // make a surrogate pair
+    *it++ = static_cast<ctype>((cp >> 10) + detail::k_lead_offset);
+    *it++ = static_cast<ctype>((cp & 0x3FF) + detail::k_trail_surrogate_min);
+  }
+  else {
+    *it++ = static_cast<ctype>(cp);
+  }
+
+  return it;
+}
+
+inline std::size_t code_point_size_u8(std::uint32_t cp) {
+  // 1 byte.
+  if (cp < 0x80) {
+    return 1;
+  }
+  // 2 bytes.
+  else if (cp < 0x800) {
+    return 2;
+  }
+  // 3 bytes.
+  else if (cp < 0x10000) {
+    return 3;
+  }
+  // 4 bytes.
+  else {
+    return 4;
+  }
+}
+
+namespace detail {
+  /// Copies the ascii run at start to outputIt in blocks when the input is contiguous.
+  /// Does nothing for other iterator types.
+  template <typename InputIt, typename OutputIt>
+  inline void copy_ascii_run(InputIt& start, InputIt end, OutputIt& outputIt) {
+    if constexpr (std::is_pointer_v<InputIt>) {
+      const std::size_t n = ascii_prefix_length(start, static_cast<std::size_t>(end - start));
+      outputIt = copy_ascii(start, start + n, outputIt);
+      start += n;
+    }
+  }
+
+  template <typename InputIt>
+  inline conversion_error make_error(error_code code, InputIt first, InputIt position) {
+    return { code, static_cast<std::size_t>(std::distance(first, position)) };
+  }
+
+  /// Checked decoding of the code point at it, for any input encoding.
+  template <encoding InputEncoding, typename InputIt>
+  inline error_code decode_next(InputIt& it, InputIt end, std::uint32_t& cp) noexcept {
+    if constexpr (InputEncoding == encoding::utf8) {
+      return decode_u8(it, end, cp);
+    }
+    else if constexpr (InputEncoding == encoding::utf16) {
+      return decode_u16(it, end, cp);
+    }
+    else {
+      cp = static_cast<std::uint32_t>(*it++);
+      return check_u32(cp);
+    }
+  }
+
+  /// Decodes the code point at it and moves it past its maximal subpart, ill-formed sequences give U+FFFD.
+  template <typename CharT>
+  inline char32_t decode_or_replace(const CharT*& it, const CharT* end) noexcept {
+    std::uint32_t cp;
+    if (decode_next<encoding_of<CharT>::value>(it, end, cp) != error_code::none) {
+      return k_replacement_character;
+    }
+
+    return static_cast<char32_t>(cp);
+  }
+
+  template <encoding OutputEncoding, typename OutputIt>
+  inline constexpr OutputIt append_code_point(std::uint32_t cp, OutputIt outputIt) {
+    if constexpr (OutputEncoding == encoding::utf8) {
+      return append_u32_to_u8(cp, outputIt);
+    }
+    else if constexpr (OutputEncoding == encoding::utf16) {
+      return append_u32_to_u16(cp, outputIt);
+    }
+    else {
+      *outputIt++ = static_cast<output_iterator_value_type_t<OutputIt>>(cp);
+      return outputIt;
+    }
+  }
+
+  /// Copies the units of a well-formed sequence when converting to the same encoding,
+  /// re-encodes the code point otherwise.
+  template <encoding InputEncoding, encoding OutputEncoding, typename InputIt, typename OutputIt>
+  inline OutputIt append_sequence(InputIt first, InputIt last, std::uint32_t cp, OutputIt outputIt) {
+    if constexpr (InputEncoding == OutputEncoding) {
+      using ctype = output_iterator_value_type_t<OutputIt>;
+      for (; first != last; ++first) {
+        *outputIt++ = static_cast<ctype>(*first);
+      }
+      return outputIt;
+    }
+    else {
+      return append_code_point<OutputEncoding>(cp, outputIt);
+    }
+  }
+
+  /// Checked conversion loop shared by the strict and lossy converters.
+  /// Ascii runs are copied in blocks, every other sequence goes through the checked decoder.
+  /// With the strict policy, stops at the first error. With the replace policy, writes U+FFFD
+  /// for each maximal subpart of an ill-formed sequence and keeps going.
+  template <class Policy, encoding InputEncoding, encoding OutputEncoding, typename InputIt, typename OutputIt>
+  OutputIt transcode_checked(
+      InputIt start, InputIt end, OutputIt outputIt, conversion_error& error, std::size_t& replacements) {
+    const InputIt first = start;
+    error = {};
+    replacements = 0;
+
+    while (start != end) {
+      copy_ascii_run(start, end, outputIt);
+      if (start == end) {
+        break;
+      }
+
+      const InputIt seq = start;
+      std::uint32_t cp;
+      const error_code code = decode_next<InputEncoding>(start, end, cp);
+
+      if (code == error_code::none) {
+        outputIt = append_sequence<InputEncoding, OutputEncoding>(seq, start, cp, outputIt);
+        continue;
+      }
+
+      if (!error) {
+        error = make_error(code, first, seq);
+      }
+
+      if constexpr (std::is_same_v<Policy, replace>) {
+        replacements++;
+        outputIt = append_code_point<OutputEncoding>(k_replacement_character, outputIt);
+      }
+      else {
+        break;
+      }
+    }
+
+    return outputIt;
+  }
+
+  /// Converter entry point for the checked policies.
+  template <class Policy, encoding InputEncoding, encoding OutputEncoding, typename InputIt, typename OutputIt>
+  inline copy_result_t<Policy, OutputIt> transcode_with_policy(InputIt start, InputIt end, OutputIt outputIt) {
+    conversion_error error;
+    std::size_t replacements;
+    outputIt = transcode_checked<Policy, InputEncoding, OutputEncoding>(start, end, outputIt, error, replacements);
+
+    if constexpr (std::is_same_v<Policy, strict>) {
+      return { outputIt, error };
+    }
+    else {
+      return outputIt;
+    }
+  }
+
+  template <class Policy, typename InputCharT, typename OutputIt>
+  inline OutputIt copy_checked(std::basic_string_view<InputCharT> input_view, OutputIt outputIt,
+      conversion_error& error, std::size_t& replacements) {
+    constexpr encoding input_encoding = encoding_of<InputCharT>::value;
+    constexpr encoding output_encoding = encoding_of<output_iterator_value_type_t<OutputIt>>::value;
+
+    const InputCharT* first = input_view.data();
+    return transcode_checked<Policy, input_encoding, output_encoding>(
+        first, first + input_view.size(), outputIt, error, replacements);
+  }
+} // namespace detail.
+
+template <typename u8_iterator>
+inline constexpr std::uint32_t next_u8_to_u32(u8_iterator& it) {
+  std::uint32_t cp = detail::cast_8(*it);
+
+  using difference_type = typename std::iterator_traits<u8_iterator>::difference_type;
+  difference_type length = static_cast<difference_type>(detail::sequence_length(static_cast<std::uint8_t>(*it)));
+
+  switch (length) {
+  case 1:
+    break;
+  case 2:
+    it++;
+    cp = ((cp << 6) & 0x7FF) + ((*it) & 0x3F);
+    break;
+  case 3:
+    ++it;
+    cp = ((cp << 12) & 0xFFFF) + ((detail::cast_8(*it) << 6) & 0xFFF);
+    ++it;
+    cp += (*it) & 0x3F;
+    break;
+  case 4:
+    ++it;
+    cp = ((cp << 18) & 0x1FFFFF) + ((detail::cast_8(*it) << 12) & 0x3FFFF);
+    ++it;
+    cp += (detail::cast_8(*it) << 6) & 0xFFF;
+    ++it;
+    cp += (*it) & 0x3F;
+    break;
+  }
+  ++it;
+  return cp;
+}
+
+template <typename octet_iterator>
+std::uint32_t prior_u8_to_u32(octet_iterator& it) {
+  while (detail::is_trail(*(--it)))
+    ;
+
+  octet_iterator temp = it;
+  return next_u8_to_u32(temp);
+}
+
+namespace detail {
+  template <typename Iterator>
+  inline constexpr bool is_random_access_v = std::is_base_of_v<std::random_access_iterator_tag,
+      typename std::iterator_traits<Iterator>::iterator_category>;
+
+  template <typename Iterator>
+  inline constexpr bool is_bidirectional_v = std::is_base_of_v<std::bidirectional_iterator_tag,
+      typename std::iterator_traits<Iterator>::iterator_category>;
+
+  /// The unchecked converters run their main loop on [start, unchecked_end<N>(start, end)), where
+  /// a sequence of up to N units can be read without looking at end. The remaining units (at most
+  /// N - 1, or the whole input for non random access iterators) go through a bounds-checked tail.
+  template <std::size_t N, typename Iterator>
+  inline Iterator unchecked_end(Iterator start, Iterator end) {
+    if constexpr (is_random_access_v<Iterator>) {
+      using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+      constexpr difference_type n = static_cast<difference_type>(N);
+      return (end - start) >= n ? end - (n - 1) : start;
+    }
+    else {
+      return start;
+    }
+  }
+
+  /// Same as next_u8_to_u32() but never reads past end.
+  /// A sequence truncated by end is consumed and decoded as U+FFFD.
+  template <typename u8_iterator>
+  inline std::uint32_t next_u8_to_u32_tail(u8_iterator& it, u8_iterator end) {
+    u8_iterator probe = it;
+    const std::size_t length = sequence_length(cast_8(*probe));
+
+    for (std::size_t i = 1; i < length; i++) {
+      if (++probe == end) {
+        it = end;
+        return k_replacement_character;
+      }
+    }
+
+    return next_u8_to_u32(it);
+  }
+
+  template <typename u16_iterator>
+  inline std::uint32_t next_u16_to_u32(u16_iterator& it) {
+    std::uint32_t cp = cast_16(*it++);
+
+    // Take care of surrogate pairs first.
+    if (is_high_surrogate(static_cast<char16_t>(cp))) {
+      cp = (cp << 10) + static_cast<std::uint32_t>(cast_16(*it++)) + k_surrogate_offset;
+    }
+
+    return cp;
+  }
+
+  /// Same as next_u16_to_u32() but never reads past end.
+  /// A lead surrogate at the end is consumed and decoded as U+FFFD.
+  template <typename u16_iterator>
+  inline std::uint32_t next_u16_to_u32_tail(u16_iterator& it, u16_iterator end) {
+    std::uint32_t cp = cast_16(*it++);
+
+    if (is_high_surrogate(static_cast<char16_t>(cp))) {
+      if (it == end) {
+        return k_replacement_character;
+      }
+
+      cp = (cp << 10) + static_cast<std::uint32_t>(cast_16(*it++)) + k_surrogate_offset;
+    }
+
+    return cp;
+  }
+} // namespace detail.
+
+template <class Policy = assume_valid, typename u16_iterator, typename u8_iterator>
+copy_result_t<Policy, u16_iterator> u8_to_u16(u8_iterator start, u8_iterator end, u16_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf8, encoding::utf16>(start, end, outputIt);
+  }
+  else {
+    if constexpr (detail::is_random_access_v<u8_iterator>) {
+      for (const u8_iterator last = detail::unchecked_end<4>(start, end); start < last;) {
+        outputIt = append_u32_to_u16(next_u8_to_u32(start), outputIt);
+      }
+    }
+
+    while (start != end) {
+      outputIt = append_u32_to_u16(detail::next_u8_to_u32_tail(start, end), outputIt);
+    }
+
+    return outputIt;
+  }
+}
+
+template <typename u8_iterator>
+std::size_t u8_to_u16_length(u8_iterator start, u8_iterator end) {
+  std::size_t count = 0;
+
+  if constexpr (detail::is_random_access_v<u8_iterator>) {
+    for (const u8_iterator last = detail::unchecked_end<4>(start, end); start < last;) {
+      count += (next_u8_to_u32(start) > 0xFFFF) ? std::size_t{ 2 } : 1;
+    }
+  }
+
+  while (start != end) {
+    count += (detail::next_u8_to_u32_tail(start, end) > 0xFFFF) ? std::size_t{ 2 } : 1;
+  }
+
+  return count;
+}
+
+template <class Policy = assume_valid, typename u32_iterator, typename u8_iterator>
+copy_result_t<Policy, u32_iterator> u8_to_u32(u8_iterator start, u8_iterator end, u32_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf8, encoding::utf32>(start, end, outputIt);
+  }
+  else {
+    using ctype = detail::output_iterator_value_type_t<u32_iterator>;
+
+    if constexpr (detail::is_random_access_v<u8_iterator>) {
+      for (const u8_iterator last = detail::unchecked_end<4>(start, end); start < last;) {
+        *outputIt++ = static_cast<ctype>(next_u8_to_u32(start));
+      }
+    }
+
+    while (start != end) {
+      *outputIt++ = static_cast<ctype>(detail::next_u8_to_u32_tail(start, end));
+    }
+
+    return outputIt;
+  }
+}
+
+template <typename u8_iterator>
+std::size_t u8_to_u32_length(u8_iterator start, u8_iterator end) {
+  std::size_t count = 0;
+
+  if constexpr (detail::is_random_access_v<u8_iterator>) {
+    using difference_type = typename std::iterator_traits<u8_iterator>::difference_type;
+
+    for (const u8_iterator last = detail::unchecked_end<4>(start, end); start < last; count++) {
+      const std::size_t length = detail::sequence_length(detail::cast_8(*start));
+      start += static_cast<difference_type>(length ? length : 1);
+    }
+  }
+
+  // A truncated sequence at the end still counts as one code point.
+  for (; start != end; count++) {
+    std::size_t length = detail::sequence_length(detail::cast_8(*start++));
+    if (length == 0) {
+      length = 1;
+    }
+
+    while (--length > 0 && start != end) {
+      ++start;
+    }
+  }
+
+  return count;
+}
+
+template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char), std::nullptr_t> = nullptr>
+std::size_t u8_length(const CharT* str, std::size_t size) noexcept {
+  std::size_t dist = 0;
+
+  for (std::size_t i = 0; i < size; dist++) {
+    const std::size_t length = detail::sequence_length(static_cast<std::uint8_t>(str[i]));
+    i += length ? length : 1;
+  }
+
+  return dist;
+}
+
+template <class Policy = assume_valid, typename u16_iterator, typename u8_iterator>
+copy_result_t<Policy, u8_iterator> u16_to_u8(u16_iterator start, u16_iterator end, u8_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf16, encoding::utf8>(start, end, outputIt);
+  }
+  else {
+    if constexpr (detail::is_random_access_v<u16_iterator>) {
+      for (const u16_iterator last = detail::unchecked_end<2>(start, end); start < last;) {
+        outputIt = append_u32_to_u8(detail::next_u16_to_u32(start), outputIt);
+      }
+    }
+
+    while (start != end) {
+      outputIt = append_u32_to_u8(detail::next_u16_to_u32_tail(start, end), outputIt);
+    }
+
+    return outputIt;
+  }
+}
+
+template <class Policy = assume_valid, typename u16_iterator, typename u32_iterator>
+copy_result_t<Policy, u32_iterator> u16_to_u32(u16_iterator start, u16_iterator end, u32_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf16, encoding::utf32>(start, end, outputIt);
+  }
+  else {
+    using ctype = detail::output_iterator_value_type_t<u32_iterator>;
+
+    if constexpr (detail::is_random_access_v<u16_iterator>) {
+      for (const u16_iterator last = detail::unchecked_end<2>(start, end); start < last;) {
+        *outputIt++ = static_cast<ctype>(detail::next_u16_to_u32(start));
+      }
+    }
+
+    while (start != end) {
+      *outputIt++ = static_cast<ctype>(detail::next_u16_to_u32_tail(start, end));
+    }
+
+    return outputIt;
+  }
+}
+
+template <typename u16_iterator>
+std::size_t u16_to_u8_length(u16_iterator start, u16_iterator end) {
+  std::size_t count = 0;
+
+  if constexpr (detail::is_random_access_v<u16_iterator>) {
+    for (const u16_iterator last = detail::unchecked_end<2>(start, end); start < last;) {
+      count += code_point_size_u8(detail::next_u16_to_u32(start));
+    }
+  }
+
+  while (start != end) {
+    count += code_point_size_u8(detail::next_u16_to_u32_tail(start, end));
+  }
+
+  return count;
+}
+
+template <typename u16_iterator>
+std::size_t u16_to_u32_length(u16_iterator start, u16_iterator end) {
+  std::size_t count = 0;
+
+  for (; start != end; count++) {
+    // A lead surrogate at the end still counts as one code point.
+    if (detail::is_high_surrogate(static_cast<char16_t>(detail::cast_16(*start++))) && start != end) {
+      ++start;
+    }
+  }
+
+  return count;
+}
+
+template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char16_t), std::nullptr_t> = nullptr>
+std::size_t u16_length(const CharT* str, std::size_t size) noexcept {
+  std::size_t dist = 0;
+
+  for (std::size_t i = 0; i < size; i++) {
+    if (detail::is_high_surrogate(detail::cast_16(str[i]))) {
+      i++;
+    }
+
+    dist++;
+  }
+
+  return dist;
+}
+
+template <class Policy = assume_valid, typename u8_iterator, typename u32_iterator>
+copy_result_t<Policy, u8_iterator> u32_to_u8(u32_iterator start, u32_iterator end, u8_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf32, encoding::utf8>(start, end, outputIt);
+  }
+  else {
+    while (start != end) {
+      outputIt = append_u32_to_u8(static_cast<std::uint32_t>(*start++), outputIt);
+    }
+
+    return outputIt;
+  }
+}
+
+template <class Policy = assume_valid, typename u16_iterator, typename u32_iterator>
+copy_result_t<Policy, u16_iterator> u32_to_u16(u32_iterator start, u32_iterator end, u16_iterator outputIt) {
+  if constexpr (!std::is_same_v<Policy, assume_valid>) {
+    return detail::transcode_with_policy<Policy, encoding::utf32, encoding::utf16>(start, end, outputIt);
+  }
+  else {
+    while (start != end) {
+      std::uint32_t cp = static_cast<std::uint32_t>(*start++);
+
+      using value_type = unicode::detail::output_iterator_value_type_t<u16_iterator>;
+
+      if (cp <= 0x0000FFFF) {
+        // UTF-16 surrogate values are illegal in UTF-32
+        // 0xFFFF or 0xFFFE are both reserved values.
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+          *outputIt++ = 0x0000FFFD;
+        }
+        else {
+          // BMP character.
+          *outputIt++ = static_cast<value_type>(cp);
+        }
+      }
+      else if (cp > 0x0010FFFF) {
+        // U+10FFFF is the largest code point of Unicode character set.
+        *outputIt++ = static_cast<value_type>(0x0000FFFD);
+      }
+      else {
+        // c32 is a character in range 0xFFFF - 0x10FFFF.
+        cp -= 0x0010000UL;
+        *outputIt++ = static_cast<value_type>(((cp >> 10) + 0xD800));
+        *outputIt++ = static_cast<value_type>(((cp & 0x3FFUL) + 0xDC00));
+      }
+    }
+
+    return outputIt;
+  }
+}
+
+template <typename u32_iterator>
+std::size_t u32_to_u8_length(u32_iterator start, u32_iterator end) {
+  std::size_t count = 0;
+
+  while (start != end) {
+    count += code_point_size_u8(static_cast<std::uint32_t>(*start++));
+  }
+
+  return count;
+}
+
+template <typename u32_iterator>
+std::size_t u32_to_u16_length(u32_iterator start, u32_iterator end) {
+  std::size_t count = 0;
+
+  while (start != end) {
+    std::uint32_t cp = static_cast<std::uint32_t>(*start++);
+    count += (cp <= 0x0000FFFF || cp > 0x0010FFFF) ? 1 : 2;
+  }
+
+  return count;
+}
+
+template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char32_t), std::nullptr_t> = nullptr>
+std::size_t u32_length(const CharT*, std::size_t size) noexcept {
+  return size;
+}
+
+template <typename u8_iterator>
+conversion_error u8_validate(u8_iterator start, u8_iterator end) {
+  const u8_iterator first = start;
+
+  while (start != end) {
+    if constexpr (std::is_pointer_v<u8_iterator>) {
+      start += detail::ascii_prefix_length(start, static_cast<std::size_t>(end - start));
+      if (start == end) {
+        break;
+      }
+    }
+
+    const u8_iterator seq = start;
+    std::uint32_t cp;
+    if (error_code code = detail::decode_u8(start, end, cp); code != error_code::none) {
+      return detail::make_error(code, first, seq);
+    }
+  }
+
+  return {};
+}
+
+template <typename u16_iterator>
+conversion_error u16_validate(u16_iterator start, u16_iterator end) {
+  const u16_iterator first = start;
+
+  while (start != end) {
+    const u16_iterator seq = start;
+    std::uint32_t cp;
+    if (error_code code = detail::decode_u16(start, end, cp); code != error_code::none) {
+      return detail::make_error(code, first, seq);
+    }
+  }
+
+  return {};
+}
+
+template <typename u32_iterator>
+conversion_error u32_validate(u32_iterator start, u32_iterator end) {
+  for (u32_iterator it = start; it != end; ++it) {
+    if (error_code code = detail::check_u32(static_cast<std::uint32_t>(*it)); code != error_code::none) {
+      return detail::make_error(code, start, it);
+    }
+  }
+
+  return {};
+}
+
+template <typename CharT, typename SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t>>
+inline std::size_t convert_size(const SType& str) {
+  using input_char_type = unicode::string_char_type_t<SType>;
+  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+  using output_char_type = CharT;
+  constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+
+  std::basic_string_view<input_char_type> input_view(str);
+
+  if constexpr (input_encoding == encoding::utf8) {
+    if constexpr (output_encoding == encoding::utf8) {
+      return input_view.size();
+    }
+    else if constexpr (output_encoding == encoding::utf16) {
+      return u8_to_u16_length(input_view.begin(), input_view.end());
+    }
+    else if constexpr (output_encoding == encoding::utf32) {
+      return u8_to_u32_length(input_view.begin(), input_view.end());
+    }
+    else {
+      return 0;
+    }
+  }
+  else if constexpr (input_encoding == encoding::utf16) {
+    if constexpr (output_encoding == encoding::utf8) {
+      return u16_to_u8_length(input_view.begin(), input_view.end());
+    }
+    else if constexpr (output_encoding == encoding::utf16) {
+      return input_view.size();
+    }
+    else if constexpr (output_encoding == encoding::utf32) {
+      return u16_to_u32_length(input_view.begin(), input_view.end());
+    }
+    else {
+      return 0;
+    }
+  }
+  else if constexpr (input_encoding == encoding::utf32) {
+    if constexpr (output_encoding == encoding::utf8) {
+      return u32_to_u8_length(input_view.begin(), input_view.end());
+    }
+    else if constexpr (output_encoding == encoding::utf16) {
+      return u32_to_u16_length(input_view.begin(), input_view.end());
+    }
+    else if constexpr (output_encoding == encoding::utf32) {
+      return input_view.size();
+    }
+    else {
+      return 0;
+    }
+  }
+  else {
+    return 0;
+  }
+}
+
+template <typename CharT, class Policy, typename SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value && is_error_policy<Policy>::value,
+        std::nullptr_t>>
+inline convert_result_t<Policy, CharT> convert_as(const SType& str, std::size_t* replacements) {
+  using input_char_type = unicode::string_char_type_t<SType>;
+  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+  using output_char_type = CharT;
+  constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+
+  std::basic_string_view<input_char_type> input_view(str);
+
+  if (replacements) {
+    *replacements = 0;
+  }
+
+  if constexpr (std::is_same_v<Policy, strict>) {
+    conversion_result<output_char_type> result;
+
+    if constexpr (input_encoding == output_encoding) {
+      result.error = unicode::validate(input_view);
+      const std::size_t size = result.error ? result.error.position : input_view.size();
+      result.value.assign(reinterpret_cast<const output_char_type*>(input_view.data()), size);
+    }
+    else {
+      std::size_t count;
+      result.value.reserve(input_view.size());
+      detail::copy_checked<strict>(input_view, std::back_inserter(result.value), result.error, count);
+    }
+
+    return result;
+  }
+  else if constexpr (std::is_same_v<Policy, replace>) {
+    std::basic_string<output_char_type> output;
+    conversion_error error;
+    std::size_t count = 0;
+
+    if constexpr (input_encoding == output_encoding) {
+      // Valid input is copied as is, the repair loop only starts at the first error.
+      error = unicode::validate(input_view);
+      const std::size_t size = error ? error.position : input_view.size();
+      output.reserve(input_view.size());
+      output.assign(reinterpret_cast<const output_char_type*>(input_view.data()), size);
+
+      if (error) {
+        detail::copy_checked<replace>(input_view.substr(size), std::back_inserter(output), error, count);
+      }
+    }
+    else {
+      output.reserve(input_view.size());
+      detail::copy_checked<replace>(input_view, std::back_inserter(output), error, count);
+    }
+
+    if (replacements) {
+      *replacements = count;
+    }
+
+    return output;
+  }
+  else {
+    if constexpr (input_encoding == encoding::utf8) {
+      if constexpr (output_encoding == encoding::utf8) {
+        return std::basic_string<output_char_type>(
+            reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        std::basic_string<output_char_type> output;
+        u8_to_u16(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        std::basic_string<output_char_type> output;
+        u8_to_u32(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else {
+        return {};
+      }
+    }
+    else if constexpr (input_encoding == encoding::utf16) {
+      if constexpr (output_encoding == encoding::utf8) {
+        std::basic_string<output_char_type> output;
+        u16_to_u8(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        return std::basic_string<output_char_type>(
+            reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        std::basic_string<output_char_type> output;
+        u16_to_u32(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else {
+        return {};
+      }
+    }
+    else if constexpr (input_encoding == encoding::utf32) {
+      if constexpr (output_encoding == encoding::utf8) {
+        std::basic_string<output_char_type> output;
+        u32_to_u8(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        std::basic_string<output_char_type> output;
+        u32_to_u16(input_view.begin(), input_view.end(), std::back_inserter(output));
+        return output;
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        return std::basic_string<output_char_type>(
+            reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
+      }
+      else {
+        return {};
+      }
+    }
+    else {
+      return {};
+    }
+  }
+}
+
+template <typename CharT, typename SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t>>
+inline conversion_result<CharT> convert_as_strict(const SType& str) {
+  return convert_as<CharT, strict>(str);
+}
+
+template <typename CharT, typename SType,
+    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t>>
+inline std::basic_string<CharT> convert_as_lossy(const SType& str, std::size_t* replacements) {
+  return convert_as<CharT, replace>(str, replacements);
+}
+
+template <class SType, class OutputIt, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+inline OutputIt copy_lossy(const SType& str, OutputIt outputIt, std::size_t* replacements) {
+  return copy<replace>(str, outputIt, replacements);
+}
+
+template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+inline conversion_error validate(const SType& str) {
+  using input_char_type = unicode::string_char_type_t<SType>;
+  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+  std::basic_string_view<input_char_type> input_view(str);
+  const input_char_type* first = input_view.data();
+  const input_char_type* last = first + input_view.size();
+
+  if constexpr (input_encoding == encoding::utf8) {
+    return u8_validate(first, last);
+  }
+  else if constexpr (input_encoding == encoding::utf16) {
+    return u16_validate(first, last);
+  }
+  else if constexpr (input_encoding == encoding::utf32) {
+    return u32_validate(first, last);
+  }
+  else {
+    return {};
+  }
+}
+
+template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+class convert {
+public:
+  using input_char_type = unicode::string_char_type_t<SType>;
+  static constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+  inline convert(const SType& str)
+      : _input_view(str) {}
+
+  template <typename CharT>
+  inline operator std::basic_string<CharT>() const {
+    return convert_as<CharT>(_input_view);
+  }
+
+private:
+  std::basic_string_view<input_char_type> _input_view;
+};
+
+template <class SType>
+convert(const SType&) -> convert<SType>;
+
+template <class Policy, class SType, class OutputIt,
+    std::enable_if_t<is_string_type<SType>::value && is_error_policy<Policy>::value, std::nullptr_t>>
+inline copy_result_t<Policy, OutputIt> copy(const SType& str, OutputIt outputIt, std::size_t* replacements) {
+  using input_char_type = unicode::string_char_type_t<SType>;
+  std::basic_string_view<input_char_type> input_view(str);
+
+  if (replacements) {
+    *replacements = 0;
+  }
+
+  if constexpr (std::is_same_v<Policy, strict>) {
+    copy_result<OutputIt> result{ outputIt, {} };
+    std::size_t count;
+    result.out = detail::copy_checked<strict>(input_view, outputIt, result.error, count);
+    return result;
+  }
+  else if constexpr (std::is_same_v<Policy, replace>) {
+    conversion_error error;
+    std::size_t count = 0;
+    outputIt = detail::copy_checked<replace>(input_view, outputIt, error, count);
+
+    if (replacements) {
+      *replacements = count;
+    }
+
+    return outputIt;
+  }
+  else {
+    constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+    using output_char_type = detail::output_iterator_value_type_t<OutputIt>;
+    constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+
+    if constexpr (input_encoding == encoding::utf8) {
+      if constexpr (output_encoding == encoding::utf8) {
+        for (std::size_t i = 0; i < input_view.size(); i++) {
+          *outputIt++ = static_cast<output_char_type>(input_view[i]);
+        }
+        return outputIt;
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        return u8_to_u16(input_view.begin(), input_view.end(), outputIt);
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        return u8_to_u32(input_view.begin(), input_view.end(), outputIt);
+      }
+    }
+    else if constexpr (input_encoding == encoding::utf16) {
+      if constexpr (output_encoding == encoding::utf8) {
+        return u16_to_u8(input_view.begin(), input_view.end(), outputIt);
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        for (std::size_t i = 0; i < input_view.size(); i++) {
+          *outputIt++ = static_cast<output_char_type>(input_view[i]);
+        }
+        return outputIt;
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        return u16_to_u32(input_view.begin(), input_view.end(), outputIt);
+      }
+    }
+    else if constexpr (input_encoding == encoding::utf32) {
+      if constexpr (output_encoding == encoding::utf8) {
+        return u32_to_u8(input_view.begin(), input_view.end(), outputIt);
+      }
+      else if constexpr (output_encoding == encoding::utf16) {
+        return u32_to_u16(input_view.begin(), input_view.end(), outputIt);
+      }
+      else if constexpr (output_encoding == encoding::utf32) {
+        for (std::size_t i = 0; i < input_view.size(); i++) {
+          *outputIt++ = static_cast<output_char_type>(input_view[i]);
+        }
+        return outputIt;
+      }
+    }
+  }
+}
+
+template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+inline std::size_t length(const SType& str) {
+  using input_char_type = unicode::string_char_type_t<SType>;
+  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+
+  std::basic_string_view<input_char_type> input_view(str);
+
+  if constexpr (input_encoding == encoding::utf8) {
+    return u8_length(input_view.data(), input_view.size());
+  }
+  else if constexpr (input_encoding == encoding::utf16) {
+    return u16_length(input_view.data(), input_view.size());
+  }
+  else if constexpr (input_encoding == encoding::utf32) {
+    return u32_length(input_view.data(), input_view.size());
+  }
+  else {
+    return 0;
+  }
+}
+
+namespace detail {
+  template <encoding Encoding = encoding::utf8>
+  struct iterator_sequence_length {
+
+    template <typename T>
+    static inline constexpr std::size_t length(T lead) noexcept {
+      return sequence_length(static_cast<std::uint8_t>(lead));
+    }
+  };
+
+  template <>
+  struct iterator_sequence_length<encoding::utf16> {
+
+    template <typename T>
+    static inline constexpr std::size_t length(T c) noexcept {
+      return u16_sequence_length(static_cast<char16_t>(c));
+    }
+  };
+
+  template <>
+  struct iterator_sequence_length<encoding::utf32> {
+
+    template <typename T>
+    static inline constexpr std::size_t length(T) noexcept {
+      return 1;
+    }
+  };
+
+  /// Moves it back to the first code unit of the previous code point of a well-formed input.
+  template <encoding InputEncoding, typename Iterator>
+  inline void retreat_code_point(Iterator& it) {
+    --it;
+
+    if constexpr (InputEncoding == encoding::utf8) {
+      while (is_trail(*it)) {
+        --it;
+      }
+    }
+    else if constexpr (InputEncoding == encoding::utf16) {
+      if (is_low_surrogate(static_cast<char16_t>(*it))) {
+        --it;
+      }
+    }
+  }
+
+  /// Same as retreat_code_point() for any input, it never goes before begin and steps back over
+  /// the same maximal subparts as decode_next() steps forward.
+  template <encoding InputEncoding, typename Iterator>
+  inline void retreat_checked(Iterator& it, Iterator begin) {
+    const Iterator last = it;
+    --it;
+
+    if constexpr (InputEncoding == encoding::utf8) {
+      // A sequence of more than one unit starts with the closest non trail unit, as long as
+      // decoding from there stops at last. Otherwise the previous element is a single unit.
+      Iterator lead = it;
+      for (int i = 0; i < 3 && lead != begin && is_trail(*lead); i++) {
+        --lead;
+      }
+
+      if (lead != it && !is_trail(*lead)) {
+        Iterator next = lead;
+        std::uint32_t cp;
+        decode_u8(next, last, cp);
+
+        if (next == last) {
+          it = lead;
+        }
+      }
+    }
+    else if constexpr (InputEncoding == encoding::utf16) {
+      if (it != begin && is_low_surrogate(static_cast<char16_t>(*it))) {
+        Iterator lead = std::prev(it);
+
+        if (is_high_surrogate(static_cast<char16_t>(*lead))) {
+          it = lead;
+        }
+      }
+    }
+  }
+
+  template <typename InputCharT, typename OutputChart, typename = void>
+  struct base_iterator {};
+
+  template <typename InputCharT, typename OutputCharT>
+  struct base_iterator<InputCharT, OutputCharT,
+      std::enable_if_t<encoding_of<InputCharT>::value == encoding_of<OutputCharT>::value>> {
+
+    using input_char_type = InputCharT;
+    using output_char_type = OutputCharT;
+
+    using input_view_type = std::basic_string_view<input_char_type>;
+    using output_view_type = std::basic_string_view<output_char_type>;
+
+    using it_seq_length = detail::iterator_sequence_length<encoding_of<InputCharT>::value>;
+
+    template <typename Iterator>
+    static inline output_view_type get(Iterator it) {
+      return output_view_type(reinterpret_cast<const output_char_type*>(&(it[0])), it_seq_length::length(*it));
+    }
+
+    template <typename Iterator>
+    static inline void advance(Iterator& it) {
+      //  using value_type = unicode::detail::output_iterator_value_type_t<u16_iterator>;
+      using it_diff_type = typename std::iterator_traits<Iterator>::difference_type;
+      std::advance(it, static_cast<it_diff_type>(it_seq_length::length(*it)));
+    }
+
+    template <typename Iterator>
+    static inline void retreat(Iterator& it) {
+      retreat_code_point<encoding_of<InputCharT>::value>(it);
+    }
+  };
+
+  template <typename InputCharT, typename OutputCharT>
+  struct base_iterator<InputCharT, OutputCharT,
+      std::enable_if_t<encoding_of<InputCharT>::value != encoding_of<OutputCharT>::value>> {
+
+    using input_char_type = InputCharT;
+    using output_char_type = OutputCharT;
+
+    using input_view_type = std::basic_string_view<input_char_type>;
+    using output_view_type = std::basic_string_view<output_char_type>;
+
+    using it_seq_length = detail::iterator_sequence_length<encoding_of<InputCharT>::value>;
+
+    template <typename Iterator>
+    inline output_view_type get(Iterator it) const {
+      return output_view_type(_data.begin(),
+          static_cast<std::size_t>(std::distance(
+              _data.begin(), unicode::copy(input_view_type(&it[0], it_seq_length::length(*it)), _data.begin()))));
+    }
+
+    template <typename Iterator>
+    inline void advance(Iterator& it) {
+      using it_diff_type = typename std::iterator_traits<Iterator>::difference_type;
+      std::advance(it, static_cast<it_diff_type>(it_seq_length::length(*it)));
+    }
+
+    template <typename Iterator>
+    static inline void retreat(Iterator& it) {
+      retreat_code_point<encoding_of<InputCharT>::value>(it);
+    }
+
+    mutable std::array<output_char_type, encoding_to_max_char_count<encoding_of<OutputCharT>::value>::value> _data;
+  };
+
+  /// Iterator base of the replace and strict policies.
+  /// Every step goes through the checked decoder, which needs the end of the input.
+  template <typename InputCharT, typename OutputCharT, class Policy>
+  struct checked_base_iterator {
+    using input_char_type = InputCharT;
+    using output_char_type = OutputCharT;
+
+    using input_view_type = std::basic_string_view<input_char_type>;
+    using output_view_type = std::basic_string_view<output_char_type>;
+
+    static constexpr encoding input_encoding = encoding_of<InputCharT>::value;
+    static constexpr encoding output_encoding = encoding_of<OutputCharT>::value;
+
+    template <typename Iterator>
+    inline output_view_type get(Iterator it, Iterator end) const {
+      Iterator next = it;
+      std::uint32_t cp;
+
+      if (decode_next<input_encoding>(next, end, cp) != error_code::none) {
+        if constexpr (std::is_same_v<Policy, strict>) {
+          return output_view_type();
+        }
+        else {
+          cp = k_replacement_character;
+        }
+      }
+      else if constexpr (input_encoding == output_encoding) {
+        return output_view_type(
+            reinterpret_cast<const output_char_type*>(&(it[0])), static_cast<std::size_t>(std::distance(it, next)));
+      }
+
+      const auto last = append_code_point<output_encoding>(cp, _data.begin());
+      return output_view_type(_data.data(), static_cast<std::size_t>(std::distance(_data.begin(), last)));
+    }
+
+    template <typename Iterator>
+    static inline void advance(Iterator& it, Iterator end) {
+      std::uint32_t cp;
+      decode_next<input_encoding>(it, end, cp);
+    }
+
+    template <typename Iterator>
+    static inline void retreat(Iterator& it, Iterator begin) {
+      retreat_checked<input_encoding>(it, begin);
+    }
+
+    mutable std::array<output_char_type, encoding_to_max_char_count<output_encoding>::value> _data;
+  };
+
+  template <typename InputCharT, typename OutputCharT, class Policy>
+  using policy_base_iterator = std::conditional_t<std::is_same_v<Policy, assume_valid>,
+      base_iterator<InputCharT, OutputCharT>, checked_base_iterator<InputCharT, OutputCharT, Policy>>;
+
+  /// The bounds of the input are only kept by the iterators of the checked policies.
+  template <class IteratorType, bool Checked>
+  struct iterator_bounds {
+    inline iterator_bounds() = default;
+    inline iterator_bounds(IteratorType, IteratorType) {}
+  };
+
+  template <class IteratorType>
+  struct iterator_bounds<IteratorType, true> {
+    inline iterator_bounds() = default;
+    inline iterator_bounds(IteratorType begin, IteratorType end)
+        : _begin(begin)
+        , _end(end) {}
+
+    IteratorType _begin;
+    IteratorType _end;
+  };
+
+  template <class IteratorType>
+  using iterator_value_type = unicode::remove_cvref_t<decltype(std::declval<IteratorType>()[0])>;
+
+  template <class IteratorType, class Policy = assume_valid>
+  using iterator_base_type = basic_iterator<iterator_value_type<IteratorType>,
+      std::basic_string_view<iterator_value_type<IteratorType>>, IteratorType, Policy>;
+
+  template <typename IteratorT>
+  class iterator_range {
+    IteratorT _begin_iterator;
+    IteratorT _end_iterator;
+
+  public:
+    template <typename Container>
+    inline iterator_range(Container&& c)
+        : _begin_iterator(c.begin(), c.begin(), c.end())
+        , _end_iterator(c.end(), c.begin(), c.end()) {}
+
+    inline iterator_range(IteratorT begin_iterator, IteratorT end_iterator)
+        : _begin_iterator(std::move(begin_iterator))
+        , _end_iterator(std::move(end_iterator)) {}
+
+    inline IteratorT begin() const { return _begin_iterator; }
+    inline IteratorT end() const { return _end_iterator; }
+    inline bool empty() const { return _begin_iterator == _end_iterator; }
+  };
+
+} // namespace detail.
+
+NANO_UNICODE_CLANG_PUSH_WARNING("-Wpadded")
+template <class CharT, class SType, class IteratorType, class Policy,
+    std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+class basic_iterator : private detail::policy_base_iterator<unicode::string_char_type_t<SType>, CharT, Policy>,
+                       private detail::iterator_bounds<IteratorType, !std::is_same_v<Policy, assume_valid>> {
+  using base_type = detail::policy_base_iterator<unicode::string_char_type_t<SType>, CharT, Policy>;
+  using bounds_type = detail::iterator_bounds<IteratorType, !std::is_same_v<Policy, assume_valid>>;
+  using output_view_type = typename base_type::output_view_type;
+
+  static constexpr bool is_checked = !std::is_same_v<Policy, assume_valid>;
+
+  // True when the dereferenced views always point into the input rather than into the iterator.
+  static constexpr bool is_input_view
+      = encoding_of<string_char_type_t<SType>>::value == encoding_of<CharT>::value && !std::is_same_v<Policy, replace>;
+
+  // With a utf32 input, every code point is a single code unit.
+  static constexpr bool is_random_access
+      = encoding_of<string_char_type_t<SType>>::value == encoding::utf32 && detail::is_random_access_v<IteratorType>;
+
+  template <class T, class P>
+  friend class iterator;
+
+public:
+  typedef std::ptrdiff_t difference_type;
+  typedef output_view_type value_type;
+  typedef output_view_type reference;
+  typedef void pointer;
+  typedef std::conditional_t<is_random_access, std::random_access_iterator_tag,
+      std::conditional_t<detail::is_bidirectional_v<IteratorType>, std::bidirectional_iterator_tag,
+          std::forward_iterator_tag>>
+      iterator_category;
+
+  inline basic_iterator() = default;
+
+  inline explicit basic_iterator(IteratorType it)
+      : _it(it) {
+    static_assert(!is_checked, "The replace and strict policies need the end of the input.");
+  }
+
+  /// With the replace and strict policies, the iterator can't be decremented before it.
+  inline basic_iterator(IteratorType it, IteratorType end)
+      : bounds_type(it, end)
+      , _it(it) {}
+
+  inline basic_iterator(IteratorType it, IteratorType begin, IteratorType end)
+      : bounds_type(begin, end)
+      , _it(it) {}
+
+  inline IteratorType base() const { return _it; }
+
+  inline output_view_type operator*() const { return dereference(_it); }
+
+  inline bool operator==(const basic_iterator& rhs) const { return (_it == rhs._it); }
+
+  inline bool operator!=(const basic_iterator& rhs) const { return !(operator==(rhs)); }
+
+  inline basic_iterator& operator++() {
+    increment(_it);
+    return *this;
+  }
+
+  inline basic_iterator operator++(int) {
+    basic_iterator temp = *this;
+    increment(_it);
+    return temp;
+  }
+
+  inline basic_iterator& operator--() {
+    decrement(_it);
+    return *this;
+  }
+
+  inline basic_iterator operator--(int) {
+    basic_iterator temp = *this;
+    decrement(_it);
+    return temp;
+  }
+
+  //
+  // Random access, only with a utf32 input.
+  //
+
+  inline basic_iterator& operator+=(difference_type n) {
+    static_assert(is_random_access, "Only iterators on a utf32 input are random access.");
+    _it += n;
+    return *this;
+  }
+
+  inline basic_iterator& operator-=(difference_type n) { return *this += -n; }
+
+  inline basic_iterator operator+(difference_type n) const { return basic_iterator(*this) += n; }
+
+  inline basic_iterator operator-(difference_type n) const { return basic_iterator(*this) += -n; }
+
+  inline friend basic_iterator operator+(difference_type n, const basic_iterator& it) { return it + n; }
+
+  inline difference_type operator-(const basic_iterator& rhs) const {
+    static_assert(is_random_access, "Only iterators on a utf32 input are random access.");
+    return _it - rhs._it;
+  }
+
+  inline output_view_type operator[](difference_type n) const {
+    static_assert(is_input_view, "The view would point into a temporary iterator, use *(it + n).");
+    return *(*this + n);
+  }
+
+  inline bool operator<(const basic_iterator& rhs) const { return (*this - rhs) < 0; }
+  inline bool operator>(const basic_iterator& rhs) const { return rhs < *this; }
+  inline bool operator<=(const basic_iterator& rhs) const { return !(rhs < *this); }
+  inline bool operator>=(const basic_iterator& rhs) const { return !(*this < rhs); }
+
+private:
+  IteratorType _it;
+
+  inline output_view_type dereference(IteratorType it) const {
+    if constexpr (is_checked) {
+      return base_type::get(it, bounds_type::_end);
+    }
+    else {
+      return base_type::get(it);
+    }
+  }
+
+  inline void increment(IteratorType& it) {
+    if constexpr (is_checked) {
+      base_type::advance(it, bounds_type::_end);
+    }
+    else {
+      base_type::advance(it);
+    }
+  }
+
+  inline void decrement(IteratorType& it) {
+    if constexpr (is_checked) {
+      base_type::retreat(it, bounds_type::_begin);
+    }
+    else {
+      base_type::retreat(it);
+    }
+  }
+};
+NANO_UNICODE_CLANG_POP_WARNING()
+
+template <typename CharT, class Policy, typename SType>
+inline auto iterate_as(const SType& str) {
+  return detail::iterator_range<basic_iterator<CharT, SType, typename SType::const_iterator, Policy>>(str);
+}
+
+template <class Policy, typename SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+inline auto iterate(const SType& str) {
+  return detail::iterator_range<
+      basic_iterator<string_char_type_t<SType>, SType, typename SType::const_iterator, Policy>>(str);
+}
+
+template <class IteratorType, class Policy>
+class iterator : private detail::iterator_base_type<IteratorType, Policy> {
+  using base_type = detail::iterator_base_type<IteratorType, Policy>;
+
+public:
+  typedef std::ptrdiff_t difference_type;
+  typedef typename base_type::value_type value_type;
+  typedef typename base_type::reference reference;
+  typedef void pointer;
+  typedef typename base_type::iterator_category iterator_category;
+
+  inline iterator() = default;
+
+  inline explicit iterator(IteratorType it)
+      : _it(it) {
+    static_assert(!base_type::is_checked, "The replace and strict policies need the end of the input.");
+  }
+
+  /// With the replace and strict policies, the iterator can't be decremented before it.
+  inline iterator(IteratorType it, IteratorType end)
+      : base_type(it, end)
+      , _it(it) {}
+
+  inline iterator(IteratorType it, IteratorType begin, IteratorType end)
+      : base_type(it, begin, end)
+      , _it(it) {}
+
+  inline IteratorType base() const { return _it; }
+
+  inline typename base_type::output_view_type operator*() const { return base_type::dereference(_it); }
+
+  inline bool operator==(const iterator& rhs) const { return (_it == rhs._it); }
+
+  inline bool operator!=(const iterator& rhs) const { return !(operator==(rhs)); }
+
+  inline iterator& operator++() {
+    base_type::increment(_it);
+    return *this;
+  }
+
+  inline iterator operator++(int) {
+    iterator temp = *this;
+    base_type::increment(_it);
+    return temp;
+  }
+
+  inline iterator& operator--() {
+    base_type::decrement(_it);
+    return *this;
+  }
+
+  inline iterator operator--(int) {
+    iterator temp = *this;
+    base_type::decrement(_it);
+    return temp;
+  }
+
+  //
+  // Random access, only with a utf32 input.
+  //
+
+  inline iterator& operator+=(difference_type n) {
+    static_assert(base_type::is_random_access, "Only iterators on a utf32 input are random access.");
+    _it += n;
+    return *this;
+  }
+
+  inline iterator& operator-=(difference_type n) { return *this += -n; }
+
+  inline iterator operator+(difference_type n) const { return iterator(*this) += n; }
+
+  inline iterator operator-(difference_type n) const { return iterator(*this) += -n; }
+
+  inline friend iterator operator+(difference_type n, const iterator& it) { return it + n; }
+
+  inline difference_type operator-(const iterator& rhs) const {
+    static_assert(base_type::is_random_access, "Only iterators on a utf32 input are random access.");
+    return _it - rhs._it;
+  }
+
+  inline typename base_type::output_view_type operator[](difference_type n) const {
+    static_assert(base_type::is_input_view, "The view would point into a temporary iterator, use *(it + n).");
+    return *(*this + n);
+  }
+
+  inline bool operator<(const iterator& rhs) const { return (*this - rhs) < 0; }
+  inline bool operator>(const iterator& rhs) const { return rhs < *this; }
+  inline bool operator<=(const iterator& rhs) const { return !(rhs < *this); }
+  inline bool operator>=(const iterator& rhs) const { return !(*this < rhs); }
+
+private:
+  IteratorType _it;
+};
+
+template <class IteratorType>
+iterator(IteratorType) -> iterator<IteratorType>;
+
+template <class IteratorType>
+iterator(IteratorType, IteratorType) -> iterator<IteratorType>;
+
+template <class IteratorType>
+iterator(IteratorType, IteratorType, IteratorType) -> iterator<IteratorType>;
+
+//
+//
+//
+template <typename T, std::enable_if_t<is_string_type<remove_cvref_t<T>>::value, std::nullptr_t>>
+string_view::string_view(T&& s)
+    : string_view(make<T>(std::forward<T>(s))) {}
+
+string_view::string_view() noexcept
+    : m_data()
+    , m_bits(pack(0, sizeof(char), false)) {
+  // Sizes up to max_size() survive the packing with the flags.
+  static_assert(unpack_size(pack(max_size(), sizeof(char32_t), true)) == max_size());
+  static_assert((pack(max_size(), sizeof(char32_t), true) & k_char_size_mask) == 2);
+}
+
+string_view::string_view(const std::string& str, normal_tag) noexcept
+    : m_data{ str.c_str() }
+    , m_bits(pack(str.size(), sizeof(char), true)) {}
+
+string_view::string_view(const std::u16string& str, normal_tag) noexcept
+    : m_data{ str.c_str() }
+    , m_bits(pack(str.size(), sizeof(char16_t), true)) {}
+
+string_view::string_view(const std::u32string& str, normal_tag) noexcept
+    : m_data{ str.c_str() }
+    , m_bits(pack(str.size(), sizeof(char32_t), true)) {}
+
+string_view::string_view(const std::wstring& str, normal_tag) noexcept
+    : m_data{ str.c_str() }
+    , m_bits(pack(str.size(), sizeof(wchar_t), true)) {}
+
+string_view::string_view(std::string_view str, normal_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char), false)) {}
+
+string_view::string_view(std::u16string_view str, normal_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char16_t), false)) {}
+
+string_view::string_view(std::u32string_view str, normal_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char32_t), false)) {}
+
+string_view::string_view(std::wstring_view str, normal_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(wchar_t), false)) {}
+
+string_view::string_view(std::string_view str, null_terminated_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char), true)) {}
+
+string_view::string_view(std::u16string_view str, null_terminated_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char16_t), true)) {}
+
+string_view::string_view(std::u32string_view str, null_terminated_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(char32_t), true)) {}
+
+string_view::string_view(std::wstring_view str, null_terminated_tag) noexcept
+    : m_data{ str.data() }
+    , m_bits(pack(str.size(), sizeof(wchar_t), true)) {}
+
+template <class Fct>
+decltype(auto) string_view::visit(Fct&& f) const {
+  switch (encoding()) {
+  case encoding::utf16:
+    return std::forward<Fct>(f)(std::basic_string_view<char16_t>(m_data.c16, size()));
+
+  case encoding::utf32:
+    return std::forward<Fct>(f)(std::basic_string_view<char32_t>(m_data.c32, size()));
+
+  default:
+    return std::forward<Fct>(f)(std::basic_string_view<char>(m_data.c8, size()));
+  }
+}
+
+template <class Fct>
+decltype(auto) visit(Fct&& f, const string_view& a, const string_view& b) {
+  return a.visit([&](auto va) -> decltype(auto) {
+    return b.visit([&](auto vb) -> decltype(auto) { return std::forward<Fct>(f)(va, vb); });
+  });
+}
+
+string_view::content::content() noexcept
+    : c8(nullptr) {}
+
+string_view::content::content(const char* s) noexcept
+    : c8(s) {}
+
+string_view::content::content(const char16_t* s) noexcept
+    : c16(s) {}
+
+string_view::content::content(const char32_t* s) noexcept
+    : c32(s) {}
+
+string_view::content::content(const wchar_t* s) noexcept
+    : content([](const wchar_t* ws) {
+      if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return content(reinterpret_cast<const char16_t*>(ws));
+      }
+      else {
+        return content(reinterpret_cast<const char32_t*>(ws));
+      }
+    }(s)) {}
+
+const wchar_t* string_view::content::cw() const noexcept {
+  if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+    return reinterpret_cast<const wchar_t*>(c16);
+  }
+  else {
+    return reinterpret_cast<const wchar_t*>(c32);
+  }
+}
+
+enum encoding string_view::encoding() const noexcept {
+  switch (char_size()) {
+  case sizeof(char):
+    return encoding::utf8;
+  case sizeof(char16_t):
+    return encoding::utf16;
+  case sizeof(char32_t):
+    return encoding::utf32;
+  default:
+    return encoding::utf8;
   }
+}
 
-  inline constexpr std::size_t u16_sequence_length(char16_t c) noexcept { return is_high_surrogate(c) ? 2 : 1; }
+template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
+const CharT* string_view::c_str() const noexcept {
+  if constexpr (std::is_same_v<CharT, char>) {
+    return (char_size() == sizeof(char) && null_terminated()) ? m_data.c8 : nullptr;
+  }
 
-  template <typename u8_iterator>
-  inline constexpr bool starts_with_bom(u8_iterator it, u8_iterator end) noexcept {
-    return (((it != end) && (cast_8(*it++)) == bom[0]) && ((it != end) && (cast_8(*it++)) == bom[1])
-        && ((it != end) && (cast_8(*it)) == bom[2]));
+  else if constexpr (std::is_same_v<CharT, char16_t>) {
+    return (char_size() == sizeof(char16_t) && null_terminated()) ? m_data.c16 : nullptr;
   }
-} // namespace detail.
 
-template <typename u8_iterator>
-inline u8_iterator append_u32_to_u8(std::uint32_t cp, u8_iterator it) {
-  using ctype = detail::output_iterator_value_type_t<u8_iterator>;
+  else if constexpr (std::is_same_v<CharT, char32_t>) {
+    return (char_size() == sizeof(char32_t) && null_terminated()) ? m_data.c32 : nullptr;
+  }
 
-  // 1 byte.
-  if (cp < 0x80) {
-    *it++ = static_cast<ctype>(cp);
+  else if constexpr (std::is_same_v<CharT, wchar_t>) {
+    return (char_size() == sizeof(wchar_t) && null_terminated()) ? m_data.cw() : nullptr;
   }
-  // 2 bytes.
-  else if (cp < 0x800) {
-    *it++ = static_cast<ctype>((cp >> 6) | 0xC0);
-    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+
+  else {
+    // Should never happen.
+    return nullptr;
   }
-  // 3 bytes.
-  else if (cp < 0x10000) {
-    *it++ = static_cast<ctype>((cp >> 12) | 0xE0);
-    *it++ = static_cast<ctype>(((cp >> 6) & 0x3F) | 0x80);
-    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+}
+
+template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
+const CharT* string_view::data() const noexcept {
+  if constexpr (std::is_same_v<CharT, char>) {
+    return (char_size() == sizeof(char)) ? m_data.c8 : nullptr;
   }
-  // 4 bytes.
+
+  else if constexpr (std::is_same_v<CharT, char16_t>) {
+    return (char_size() == sizeof(char16_t)) ? m_data.c16 : nullptr;
+  }
+
+  else if constexpr (std::is_same_v<CharT, char32_t>) {
+    return (char_size() == sizeof(char32_t)) ? m_data.c32 : nullptr;
+  }
+
+  else if constexpr (std::is_same_v<CharT, wchar_t>) {
+    return (char_size() == sizeof(wchar_t)) ? m_data.cw() : nullptr;
+  }
+
   else {
-    *it++ = static_cast<ctype>((cp >> 18) | 0xF0);
-    *it++ = static_cast<ctype>(((cp >> 12) & 0x3F) | 0x80);
-    *it++ = static_cast<ctype>(((cp >> 6) & 0x3F) | 0x80);
-    *it++ = static_cast<ctype>((cp & 0x3F) | 0x80);
+    // Should never happen.
+    return nullptr;
   }
+}
 
-  return it;
+template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
+std::basic_string<CharT> string_view::str() const {
+  using stype = std::basic_string<CharT>;
+
+  if constexpr (std::is_same_v<CharT, char>) {
+    return (char_size() == sizeof(char)) ? stype(m_data.c8, size()) : stype();
+  }
+
+  else if constexpr (std::is_same_v<CharT, char16_t>) {
+    return (char_size() == sizeof(char16_t)) ? stype(m_data.c16, size()) : stype();
+  }
+
+  else if constexpr (std::is_same_v<CharT, char32_t>) {
+    return (char_size() == sizeof(char32_t)) ? stype(m_data.c32, size()) : stype();
+  }
+
+  else if constexpr (std::is_same_v<CharT, wchar_t>) {
+    return (char_size() == sizeof(wchar_t)) ? stype(m_data.cw(), size()) : stype();
+  }
+
+  else {
+    // Should never happen.
+    return stype();
+  }
 }
 
-inline std::size_t code_point_size_u8(std::uint32_t cp) {
-  // 1 byte.
-  if (cp < 0x80) {
-    return 1;
+template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
+std::basic_string_view<CharT> string_view::view() const {
+  using svtype = std::basic_string_view<CharT>;
+
+  if constexpr (std::is_same_v<CharT, char>) {
+    return (char_size() == sizeof(char)) ? svtype(m_data.c8, size()) : svtype();
   }
-  // 2 bytes.
-  else if (cp < 0x800) {
-    return 2;
+
+  else if constexpr (std::is_same_v<CharT, char16_t>) {
+    return (char_size() == sizeof(char16_t)) ? svtype(m_data.c16, size()) : svtype();
   }
-  // 3 bytes.
-  else if (cp < 0x10000) {
-    return 3;
+
+  else if constexpr (std::is_same_v<CharT, char32_t>) {
+    return (char_size() == sizeof(char32_t)) ? svtype(m_data.c32, size()) : svtype();
   }
-  // 4 bytes.
+
+  else if constexpr (std::is_same_v<CharT, wchar_t>) {
+    return (char_size() == sizeof(wchar_t)) ? svtype(m_data.cw(), size()) : svtype();
+  }
+
   else {
-    return 4;
+    // Should never happen.
+    return svtype();
   }
 }
 
-template <typename u8_iterator>
-inline std::uint32_t next_u8_to_u32(u8_iterator& it) {
-  std::uint32_t cp = detail::cast_8(*it);
+template <typename T>
+auto string_view::make(T&& s) {
+  using type = std::remove_cv_t<std::remove_reference_t<T>>;
 
-  using difference_type = typename std::iterator_traits<u8_iterator>::difference_type;
-  difference_type length = static_cast<difference_type>(detail::sequence_length(static_cast<std::uint8_t>(*it)));
+  constexpr bool is_any_string_or_string_view = std::is_same_v<type, std::string> //
+      || std::is_same_v<type, std::u16string> //
+      || std::is_same_v<type, std::u32string> //
+      || std::is_same_v<type, std::wstring> //
+      || std::is_same_v<type, std::string_view> //
+      || std::is_same_v<type, std::u16string_view> //
+      || std::is_same_v<type, std::u32string_view> //
+      || std::is_same_v<type, std::wstring_view>;
 
-  switch (length) {
-  case 1:
-    break;
-  case 2:
-    it++;
-    cp = ((cp << 6) & 0x7FF) + ((*it) & 0x3F);
+  static_assert(is_any_string_or_string_view || is_string_type<T>::value, "");
+
+  if constexpr (is_any_string_or_string_view) {
+    return string_view(std::forward<T>(s), normal_tag{});
+  }
+
+  else if constexpr (std::is_constructible_v<std::string_view, T>) {
+    return string_view(std::string_view(s), null_terminated_tag{});
+  }
+
+  else if constexpr (std::is_constructible_v<std::u16string_view, T>) {
+    return string_view(std::u16string_view(s), null_terminated_tag{});
+  }
+
+  else if constexpr (std::is_constructible_v<std::u32string_view, T>) {
+    return string_view(std::u32string_view(s), null_terminated_tag{});
+  }
+
+  else if constexpr (std::is_constructible_v<std::wstring_view, T>) {
+    return string_view(std::wstring_view(s), null_terminated_tag{});
+  }
+
+  else {
+    // Should never happen.
+    return string_view();
+  }
+}
+
+std::string to_utf8(string_view s) { return s.to_utf8(); }
+
+std::u16string to_utf16(string_view s) { return s.to_utf16(); }
+
+std::u32string to_utf32(string_view s) { return s.to_utf32(); }
+
+std::wstring to_wide(string_view s) { return s.to_wide(); }
+
+namespace detail {
+  /// Widening or narrowing copy of an ascii only string.
+  template <typename OutputCharT, typename InputCharT>
+  inline std::basic_string<OutputCharT> convert_ascii(std::basic_string_view<InputCharT> str) {
+    std::basic_string<OutputCharT> output(str.size(), OutputCharT());
+    std::transform(str.begin(), str.end(), output.begin(), [](InputCharT c) { return static_cast<OutputCharT>(c); });
+    return output;
+  }
+
+  template <typename OutputCharT>
+  inline std::basic_string<OutputCharT> convert_ascii(const string_view& s) {
+    switch (s.encoding()) {
+    case encoding::utf8:
+      return convert_ascii<OutputCharT>(s.view<char>());
+
+    case encoding::utf16:
+      return convert_ascii<OutputCharT>(s.view<char16_t>());
+
+    case encoding::utf32:
+      return convert_ascii<OutputCharT>(s.view<char32_t>());
+    }
+
+    return {};
+  }
+} // namespace detail.
+
+string_view& string_view::set_known_valid() noexcept {
+  m_bits |= k_valid_flag;
+  return *this;
+}
+
+string_view& string_view::set_known_ascii() noexcept {
+  m_bits |= k_valid_flag | k_ascii_flag;
+  return *this;
+}
+
+conversion_error string_view::validate() noexcept {
+  if (known_valid()) {
+    return {};
+  }
+
+  // The ascii prefix doubles as the fast path of the validation.
+  std::size_t ascii_size = 0;
+  conversion_error error;
+
+  switch (encoding()) {
+  case encoding::utf8:
+    ascii_size = detail::ascii_prefix_length(m_data.c8, size());
+    error = unicode::validate(view<char>().substr(ascii_size));
     break;
-  case 3:
-    ++it;
-    cp = ((cp << 12) & 0xFFFF) + ((detail::cast_8(*it) << 6) & 0xFFF);
-    ++it;
-    cp += (*it) & 0x3F;
+
+  case encoding::utf16:
+    ascii_size = detail::ascii_prefix_length(m_data.c16, size());
+    error = unicode::validate(view<char16_t>().substr(ascii_size));
     break;
-  case 4:
-    ++it;
-    cp = ((cp << 18) & 0x1FFFFF) + ((detail::cast_8(*it) << 12) & 0x3FFFF);
-    ++it;
-    cp += (detail::cast_8(*it) << 6) & 0xFFF;
-    ++it;
-    cp += (*it) & 0x3F;
+
+  case encoding::utf32:
+    ascii_size = detail::ascii_prefix_length(m_data.c32, size());
+    error = unicode::validate(view<char32_t>().substr(ascii_size));
     break;
   }
-  ++it;
-  return cp;
-}
 
-template <typename octet_iterator>
-std::uint32_t prior_u8_to_u32(octet_iterator& it) {
-  while (detail::is_trail(*(--it)))
-    ;
+  if (error) {
+    error.position += ascii_size;
+    return error;
+  }
+
+  if (ascii_size == size()) {
+    set_known_ascii();
+  }
+  else {
+    set_known_valid();
+  }
+
+  return {};
+}
+
+std::string string_view::to_utf8() const {
+  if (empty()) {
+    return {};
+  }
+
+  if (known_ascii()) {
+    return detail::convert_ascii<char>(*this);
+  }
+
+  switch (encoding()) {
+  case encoding::utf8:
+    return std::string(data<char>(), size());
 
-  octet_iterator temp = it;
-  return next_u8_to_u32(temp);
+  case encoding::utf16:
+    return convert_as<char>(view<char16_t>());
+
+  case encoding::utf32:
+    return convert_as<char>(view<char32_t>());
+  }
+
+  return {};
 }
 
-template <typename u16_iterator, typename u8_iterator>
-u16_iterator u8_to_u16(u8_iterator start, u8_iterator end, u16_iterator outputIt) {
-  while (start < end) {
-    std::uint32_t cp = next_u8_to_u32(start);
+std::u16string string_view::to_utf16() const {
+  if (empty()) {
+    return {};
+  }
 
-    if (cp > 0xFFFF) { // make a surrogate pair
-      *outputIt++ = detail::cast_16((cp >> 10) + detail::k_lead_offset);
-      *outputIt++ = detail::cast_16((cp & 0x3FF) + detail::k_trail_surrogate_min);
-    }
-    else {
-      *outputIt++ = detail::cast_16(cp);
-    }
+  if (known_ascii()) {
+    return detail::convert_ascii<char16_t>(*this);
   }
 
-  return outputIt;
-}
+  switch (encoding()) {
+  case encoding::utf8:
+    return convert_as<char16_t>(view<char>());
 
-template <typename u8_iterator>
-std::size_t u8_to_u16_length(u8_iterator start, u8_iterator end) {
-  std::size_t count = 0;
-  while (start < end) {
-    std::uint32_t cp = next_u8_to_u32(start);
-    count += (cp > 0xFFFF) ? 2 : 1;
+  case encoding::utf16:
+
+    return std::u16string(data<char16_t>(), size());
+
+  case encoding::utf32:
+    return convert_as<char16_t>(view<char32_t>());
   }
 
-  return count;
+  return {};
 }
 
-template <typename u32_iterator, typename u8_iterator>
-u32_iterator u8_to_u32(u8_iterator start, u8_iterator end, u32_iterator outputIt) {
-  using ctype = detail::output_iterator_value_type_t<u32_iterator>;
+std::u32string string_view::to_utf32() const {
+  if (empty()) {
+    return {};
+  }
 
-  while (start < end) {
-    *outputIt++ = static_cast<ctype>(next_u8_to_u32(start));
+  if (known_ascii()) {
+    return detail::convert_ascii<char32_t>(*this);
   }
 
-  return outputIt;
-}
+  switch (encoding()) {
+  case encoding::utf8:
+    return convert_as<char32_t>(view<char>());
 
-template <typename u8_iterator>
-std::size_t u8_to_u32_length(u8_iterator start, u8_iterator end) {
+  case encoding::utf16:
+    return convert_as<char32_t>(view<char16_t>());
 
-  std::size_t count = 0;
-  while (start < end) {
-    switch (detail::sequence_length(static_cast<std::uint8_t>(*start++))) {
-    case 1:
-      break;
-    case 2:
-      ++start;
-      break;
-    case 3:
-      ++start;
-      ++start;
-      break;
-    case 4:
-      ++start;
-      ++start;
-      ++start;
-      break;
-    }
-    count++;
+  case encoding::utf32:
+    return std::u32string(data<char32_t>(), size());
   }
 
-  return count;
+  return {};
 }
 
-template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char), std::nullptr_t> = nullptr>
-std::size_t u8_length(const CharT* str, std::size_t size) noexcept {
-  std::size_t dist = 0;
+std::wstring string_view::to_wide() const {
+  if (empty()) {
+    return {};
+  }
 
-  for (std::size_t i = 0; i < size; i += detail::sequence_length(static_cast<std::uint8_t>(str[i]))) {
-    dist++;
+  if (known_ascii()) {
+    return detail::convert_ascii<wchar_t>(*this);
   }
 
-  return dist;
+  switch (encoding()) {
+  case encoding::utf8:
+    return convert_as<wchar_t>(view<char>());
+
+  case encoding::utf16:
+    return convert_as<wchar_t>(view<char16_t>());
+
+  case encoding::utf32:
+    return convert_as<wchar_t>(view<char32_t>());
+  }
+
+  return {};
 }
 
-template <typename u16_iterator, typename u8_iterator>
-u8_iterator u16_to_u8(u16_iterator start, u16_iterator end, u8_iterator outputIt) {
-  while (start != end) {
-    std::uint32_t cp = detail::cast_16(*start++);
-    //
+namespace detail {
+  template <typename CharT>
+  inline std::basic_string<CharT> string_view_to_lossy(const string_view& s, std::size_t* replacements) {
+    if (replacements) {
+      *replacements = 0;
+    }
 
-    // Take care of surrogate pairs first.
-    if (detail::is_high_surrogate(static_cast<char16_t>(cp))) {
-      cp = (cp << 10) + static_cast<std::uint32_t>(detail::cast_16(*start++)) + detail::k_surrogate_offset;
+    if (s.empty()) {
+      return {};
     }
 
-    outputIt = append_u32_to_u8(cp, outputIt);
-  }
+    if (s.known_ascii()) {
+      return convert_ascii<CharT>(s);
+    }
 
-  return outputIt;
-}
+    if (s.known_valid()) {
+      switch (s.encoding()) {
+      case encoding::utf8:
+        return convert_as<CharT>(s.view<char>());
 
-template <typename u16_iterator, typename u32_iterator>
-u32_iterator u16_to_u32(u16_iterator start, u16_iterator end, u32_iterator outputIt) {
-  using ctype = detail::output_iterator_value_type_t<u32_iterator>;
+      case encoding::utf16:
+        return convert_as<CharT>(s.view<char16_t>());
 
-  while (start != end) {
-    std::uint32_t cp = detail::cast_16(*start++);
+      case encoding::utf32:
+        return convert_as<CharT>(s.view<char32_t>());
+      }
+    }
 
-    // Take care of surrogate pairs first.
-    if (detail::is_high_surrogate(static_cast<char16_t>(cp))) {
-      cp = (cp << 10) + static_cast<std::uint32_t>(detail::cast_16(*start++)) + detail::k_surrogate_offset;
+    switch (s.encoding()) {
+    case encoding::utf8:
+      return convert_as_lossy<CharT>(s.view<char>(), replacements);
+
+    case encoding::utf16:
+      return convert_as_lossy<CharT>(s.view<char16_t>(), replacements);
+
+    case encoding::utf32:
+      return convert_as_lossy<CharT>(s.view<char32_t>(), replacements);
     }
 
-    *outputIt++ = static_cast<ctype>(cp);
+    return {};
   }
+} // namespace detail.
 
-  return outputIt;
+std::string string_view::to_utf8_lossy(std::size_t* replacements) const {
+  return detail::string_view_to_lossy<char>(*this, replacements);
 }
 
-template <typename u16_iterator>
-std::size_t u16_to_u8_length(u16_iterator start, u16_iterator end) {
-  std::size_t count = 0;
-  while (start != end) {
-    std::uint32_t cp = detail::cast_16(*start++);
+std::u16string string_view::to_utf16_lossy(std::size_t* replacements) const {
+  return detail::string_view_to_lossy<char16_t>(*this, replacements);
+}
 
-    // Take care of surrogate pairs first.
-    if (detail::is_high_surrogate(static_cast<char16_t>(cp))) {
-      cp = (cp << 10) + static_cast<std::uint32_t>(detail::cast_16(*start++)) + detail::k_surrogate_offset;
-    }
+std::u32string string_view::to_utf32_lossy(std::size_t* replacements) const {
+  return detail::string_view_to_lossy<char32_t>(*this, replacements);
+}
+
+std::wstring string_view::to_wide_lossy(std::size_t* replacements) const {
+  return detail::string_view_to_lossy<wchar_t>(*this, replacements);
+}
 
-    count += code_point_size_u8(cp);
+std::size_t string_view::count() const {
+  if (known_ascii()) {
+    return size();
   }
 
-  return count;
+  switch (encoding()) {
+  case encoding::utf8:
+    return unicode::length(view<char>());
+
+  case encoding::utf16:
+    return unicode::length(view<char16_t>());
+
+  case encoding::utf32:
+    return size();
+  }
+  return 0;
 }
 
-template <typename u16_iterator>
-std::size_t u16_to_u32_length(u16_iterator start, u16_iterator end) {
-  std::size_t count = 0;
+namespace detail {
+  /// Moves the utf16 surrogates above U+E000..U+FFFF so that code unit order matches code point order.
+  inline std::uint32_t u16_code_point_order(std::uint32_t c) noexcept {
+    return c >= 0xE000 ? c - 0x800 : c >= 0xD800 ? c + 0x2000 : c;
+  }
 
-  while (start != end) {
-    std::uint32_t cp = detail::cast_16(*start++);
+  /// Decodes the order key of the next code point: the code point itself, or for each code unit of an
+  /// ill-formed sequence a key above U+10FFFF made of the encoding and the code unit value.
+  template <typename CharT>
+  inline std::uint64_t next_order_key(const CharT*& it, const CharT* end) noexcept {
+    const CharT* first = it;
+    std::uint32_t cp;
 
-    // Take care of surrogate pairs first.
-    if (detail::is_high_surrogate(static_cast<char16_t>(cp))) {
-      cp = (cp << 10) + static_cast<std::uint32_t>(detail::cast_16(*start++)) + detail::k_surrogate_offset;
+    if (decode_next<encoding_of<CharT>::value>(it, end, cp) == error_code::none) {
+      return cp;
     }
 
-    count++;
+    it = first + 1;
+    return (std::uint64_t{ sizeof(CharT) } << 32) | static_cast<std::make_unsigned_t<CharT>>(*first);
   }
 
-  return count;
-}
+  template <typename CharA, typename CharB>
+  inline int compare_code_points(std::basic_string_view<CharA> a, std::basic_string_view<CharB> b) noexcept {
+    // An ascii code point is a single code unit in every encoding, so the common ascii prefix is compared
+    // without decoding.
+    const std::size_t size = ascii_prefix_length(a.data(), (std::min)(a.size(), b.size()));
+    const std::size_t ascii_size = ascii_prefix_length(b.data(), size);
 
-template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char16_t), std::nullptr_t> = nullptr>
-std::size_t u16_length(const CharT* str, std::size_t size) noexcept {
-  std::size_t dist = 0;
+    for (std::size_t i = 0; i < ascii_size; i++) {
+      const std::uint32_t ca = static_cast<std::uint32_t>(a[i]);
+      const std::uint32_t cb = static_cast<std::uint32_t>(b[i]);
 
-  for (std::size_t i = 0; i < size; i++) {
-    if (detail::is_high_surrogate(detail::cast_16(str[i]))) {
-      i++;
+      if (ca != cb) {
+        return ca < cb ? -1 : 1;
+      }
     }
 
-    dist++;
-  }
+    const CharA* ita = a.data() + ascii_size;
+    const CharA* enda = a.data() + a.size();
+    const CharB* itb = b.data() + ascii_size;
+    const CharB* endb = b.data() + b.size();
 
-  return dist;
-}
+    while (ita != enda && itb != endb) {
+      const std::uint64_t ca = next_order_key(ita, enda);
+      const std::uint64_t cb = next_order_key(itb, endb);
 
-template <typename u8_iterator, typename u32_iterator>
-u8_iterator u32_to_u8(u32_iterator start, u32_iterator end, u8_iterator outputIt) {
+      if (ca != cb) {
+        return ca < cb ? -1 : 1;
+      }
+    }
 
-  while (start != end) {
-    outputIt = append_u32_to_u8(static_cast<std::uint32_t>(*start++), outputIt);
+    return ita != enda ? 1 : itb != endb ? -1 : 0;
   }
 
-  return outputIt;
-}
-
-template <typename u16_iterator, typename u32_iterator>
-u16_iterator u32_to_u16(u32_iterator start, u32_iterator end, u16_iterator outputIt) {
-  while (start != end) {
-    std::uint32_t cp = static_cast<std::uint32_t>(*start++);
+  /// Compares the code units directly when both strings are known to be valid, decodes them otherwise.
+  template <typename CharT>
+  inline int compare_same_encoding(
+      std::basic_string_view<CharT> a, std::basic_string_view<CharT> b, bool known_valid) noexcept {
+    if (!known_valid) {
+      return compare_code_points(a, b);
+    }
 
-    using value_type = unicode::detail::output_iterator_value_type_t<u16_iterator>;
+    if constexpr (sizeof(CharT) == sizeof(char16_t)) {
+      const std::size_t size = (std::min)(a.size(), b.size());
+      const auto [ita, itb] = std::mismatch(a.begin(), a.begin() + size, b.begin());
 
-    if (cp <= 0x0000FFFF) {
-      // UTF-16 surrogate values are illegal in UTF-32
-      // 0xFFFF or 0xFFFE are both reserved values.
-      if (cp >= 0xD800 && cp <= 0xDFFF) {
-        *outputIt++ = 0x0000FFFD;
+      if (ita != a.begin() + size) {
+        const std::uint32_t ca = u16_code_point_order(static_cast<std::uint32_t>(*ita));
+        const std::uint32_t cb = u16_code_point_order(static_cast<std::uint32_t>(*itb));
+        return ca < cb ? -1 : 1;
       }
-      else {
-        // BMP character.
-        *outputIt++ = static_cast<value_type>(cp);
-      }
-    }
-    else if (cp > 0x0010FFFF) {
-      // U+10FFFF is the largest code point of Unicode character set.
-      *outputIt++ = static_cast<value_type>(0x0000FFFD);
+
+      return a.size() == b.size() ? 0 : a.size() < b.size() ? -1 : 1;
     }
     else {
-      // c32 is a character in range 0xFFFF - 0x10FFFF.
-      cp -= 0x0010000UL;
-      *outputIt++ = static_cast<value_type>(((cp >> 10) + 0xD800));
-      *outputIt++ = static_cast<value_type>(((cp & 0x3FFUL) + 0xDC00));
+      // char_traits compares utf8 as unsigned bytes (which matches code point order) and utf32 by value.
+      const int result = a.compare(b);
+      return result < 0 ? -1 : result > 0 ? 1 : 0;
     }
   }
 
-  return outputIt;
-}
+  /// Equality of two strings of different encodings, an ill-formed sequence is equal to nothing.
+  template <typename CharA, typename CharB>
+  inline bool equal_code_points(std::basic_string_view<CharA> a, std::basic_string_view<CharB> b) noexcept {
+    const std::size_t size = ascii_prefix_length(a.data(), (std::min)(a.size(), b.size()));
+    const std::size_t ascii_size = ascii_prefix_length(b.data(), size);
 
-template <typename u32_iterator>
-std::size_t u32_to_u8_length(u32_iterator start, u32_iterator end) {
-  std::size_t count = 0;
+    for (std::size_t i = 0; i < ascii_size; i++) {
+      if (static_cast<std::uint32_t>(a[i]) != static_cast<std::uint32_t>(b[i])) {
+        return false;
+      }
+    }
 
-  while (start != end) {
-    count += code_point_size_u8(static_cast<std::uint32_t>(*start++));
-  }
+    const CharA* ita = a.data() + ascii_size;
+    const CharA* enda = a.data() + a.size();
+    const CharB* itb = b.data() + ascii_size;
+    const CharB* endb = b.data() + b.size();
 
-  return count;
-}
+    while (ita != enda && itb != endb) {
+      std::uint32_t ca;
+      std::uint32_t cb;
 
-template <typename u32_iterator>
-std::size_t u32_to_u16_length(u32_iterator start, u32_iterator end) {
-  std::size_t count = 0;
+      if (decode_next<encoding_of<CharA>::value>(ita, enda, ca) != error_code::none
+          || decode_next<encoding_of<CharB>::value>(itb, endb, cb) != error_code::none || ca != cb) {
+        return false;
+      }
+    }
 
-  while (start != end) {
-    std::uint32_t cp = static_cast<std::uint32_t>(*start++);
-    count += (cp <= 0x0000FFFF || cp > 0x0010FFFF) ? 1 : 2;
+    return ita == enda && itb == endb;
   }
+} // namespace detail.
 
-  return count;
-}
+bool operator==(const string_view& a, const string_view& b) noexcept {
+  if (a.char_size() == b.char_size()) {
+    return a.size() == b.size() && std::memcmp(a.m_data.c8, b.m_data.c8, a.size_bytes()) == 0;
+  }
 
-template <typename CharT, std::enable_if_t<sizeof(CharT) == sizeof(char32_t), std::nullptr_t> = nullptr>
-std::size_t u32_length(const CharT*, std::size_t size) noexcept {
-  return size;
+  return unicode::visit(
+      [](auto x, auto y) {
+        if constexpr (std::is_same_v<decltype(x), decltype(y)>) {
+          return x == y;
+        }
+        else {
+          return detail::equal_code_points(x, y);
+        }
+      },
+      a, b);
 }
 
-template <typename CharT, typename SType,
-    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t>>
-inline std::size_t convert_size(const SType& str) {
-  using input_char_type = unicode::string_char_type_t<SType>;
-  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+namespace detail {
+  inline constexpr std::uint64_t k_fnv_offset_basis = 0xCBF29CE484222325ull;
+  inline constexpr std::uint64_t k_fnv_prime = 0x100000001B3ull;
 
-  using output_char_type = CharT;
-  constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+  template <typename CharT>
+  inline std::uint64_t hash_code_points(std::basic_string_view<CharT> str) noexcept {
+    std::uint64_t h = k_fnv_offset_basis;
+    const CharT* it = str.data();
+    const CharT* end = str.data() + str.size();
 
-  std::basic_string_view<input_char_type> input_view(str);
+    while (it != end) {
+      // Ascii runs are hashed straight from the code units.
+      const CharT* ascii_end = it + ascii_prefix_length(it, static_cast<std::size_t>(end - it));
 
-  if constexpr (input_encoding == encoding::utf8) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return input_view.size();
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return u8_to_u16_length(input_view.begin(), input_view.end());
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return u8_to_u32_length(input_view.begin(), input_view.end());
-    }
-    else {
-      return 0;
-    }
-  }
-  else if constexpr (input_encoding == encoding::utf16) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return u16_to_u8_length(input_view.begin(), input_view.end());
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return input_view.size();
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return u16_to_u32_length(input_view.begin(), input_view.end());
-    }
-    else {
-      return 0;
+      for (; it != ascii_end; ++it) {
+        h = (h ^ static_cast<std::make_unsigned_t<CharT>>(*it)) * k_fnv_prime;
+      }
+
+      if (it == end) {
+        break;
+      }
+
+      std::uint32_t cp;
+      if (decode_next<encoding_of<CharT>::value>(it, end, cp) != error_code::none) {
+        cp = k_replacement_character;
+      }
+
+      h = (h ^ cp) * k_fnv_prime;
     }
+
+    return h;
   }
-  else if constexpr (input_encoding == encoding::utf32) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return u32_to_u8_length(input_view.begin(), input_view.end());
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return u32_to_u16_length(input_view.begin(), input_view.end());
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return input_view.size();
+} // namespace detail.
+
+std::size_t hash(const string_view& s) noexcept {
+  return s.visit([](auto str) { return static_cast<std::size_t>(detail::hash_code_points(str)); });
+}
+
+namespace detail {
+  /// Returns the offset of the code point n code points after offset.
+  template <typename CharT>
+  inline std::size_t advance_code_points(
+      std::basic_string_view<CharT> str, std::size_t offset, std::size_t n) noexcept {
+    if constexpr (sizeof(CharT) == sizeof(char32_t)) {
+      return (std::min)(offset + n, str.size());
     }
     else {
-      return 0;
+      const CharT* it = str.data() + offset;
+      const CharT* end = str.data() + str.size();
+
+      for (std::uint32_t cp; n && it != end; n--) {
+        decode_next<encoding_of<CharT>::value>(it, end, cp);
+      }
+
+      return static_cast<std::size_t>(it - str.data());
     }
   }
-  else {
-    return 0;
+
+  /// Returns the code point at offset, or U+FFFD if the sequence is ill-formed.
+  template <typename CharT>
+  inline char32_t code_point_at(std::basic_string_view<CharT> str, std::size_t offset) noexcept {
+    const CharT* it = str.data() + offset;
+    return decode_or_replace(it, str.data() + str.size());
   }
-}
 
-template <typename CharT, typename SType,
-    std::enable_if_t<is_string_type<SType>::value && is_char_type<CharT>::value, std::nullptr_t>>
-inline std::basic_string<CharT> convert_as(const SType& str) {
-  using input_char_type = unicode::string_char_type_t<SType>;
-  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+  /// Fills offsets with the offset of every stride-th code point and returns the code point count.
+  template <typename CharT>
+  inline std::size_t build_code_point_index(
+      std::basic_string_view<CharT> str, std::size_t stride, std::vector<std::size_t>& offsets) {
+    std::size_t count = 0;
+    std::size_t i = 0;
 
-  using output_char_type = CharT;
-  constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+    while (i < str.size()) {
+      // Within an ascii run, code points and code units match, the breadcrumbs are placed without decoding.
+      const std::size_t ascii_size = ascii_prefix_length(str.data() + i, str.size() - i);
 
-  std::basic_string_view<input_char_type> input_view(str);
+      for (std::size_t k = (count + stride - 1) / stride * stride; k < count + ascii_size; k += stride) {
+        offsets.push_back(i + k - count);
+      }
 
-  if constexpr (input_encoding == encoding::utf8) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return std::basic_string<output_char_type>(
-          reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      std::basic_string<output_char_type> output;
-      u8_to_u16(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      std::basic_string<output_char_type> output;
-      u8_to_u32(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
-    }
-    else {
-      return {};
+      i += ascii_size;
+      count += ascii_size;
+
+      if (i == str.size()) {
+        break;
+      }
+
+      if (count % stride == 0) {
+        offsets.push_back(i);
+      }
+
+      i = advance_code_points(str, i, 1);
+      count++;
     }
+
+    return count;
   }
-  else if constexpr (input_encoding == encoding::utf16) {
-    if constexpr (output_encoding == encoding::utf8) {
-      std::basic_string<output_char_type> output;
-      u16_to_u8(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return std::basic_string<output_char_type>(
-          reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      std::basic_string<output_char_type> output;
-      u16_to_u32(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
+} // namespace detail.
+
+code_point_index::code_point_index(string_view str, std::size_t stride)
+    : m_str(str)
+    , m_stride(stride ? stride : 1) {
+  m_offsets.reserve(str.size() / m_stride + 1);
+  m_count = str.visit([&](auto s) { return detail::build_code_point_index(s, m_stride, m_offsets); });
+}
+
+std::size_t code_point_index::offset(std::size_t cp_index) const noexcept {
+  if (cp_index >= m_count) {
+    return m_str.size();
+  }
+
+  const std::size_t start = m_offsets[cp_index / m_stride];
+  const std::size_t n = cp_index % m_stride;
+
+  return m_str.visit([&](auto str) { return detail::advance_code_points(str, start, n); });
+}
+
+char32_t code_point_index::at(std::size_t cp_index) const noexcept {
+  if (cp_index >= m_count) {
+    return 0;
+  }
+
+  const std::size_t pos = offset(cp_index);
+  return m_str.visit([&](auto str) { return detail::code_point_at(str, pos); });
+}
+
+namespace detail {
+  /// Returns the view [first, last) of s, which must start and end on code point boundaries.
+  /// What is known about the content of s still holds for the sub view.
+  inline string_view sub_view(const string_view& s, std::size_t first, std::size_t last) noexcept {
+    string_view sub = s.visit([&](auto str) { return string_view(str.substr(first, last - first)); });
+
+    if (s.known_ascii()) {
+      sub.set_known_ascii();
     }
-    else {
-      return {};
+    else if (s.known_valid()) {
+      sub.set_known_valid();
     }
+
+    return sub;
   }
-  else if constexpr (input_encoding == encoding::utf32) {
-    if constexpr (output_encoding == encoding::utf8) {
-      std::basic_string<output_char_type> output;
-      u32_to_u8(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
+} // namespace detail.
+
+string_view code_point_index::substr_cp(std::size_t pos, std::size_t n) const noexcept {
+  pos = (std::min)(pos, m_count);
+  n = (std::min)(n, m_count - pos);
+
+  return detail::sub_view(m_str, offset(pos), offset(pos + n));
+}
+
+namespace detail {
+  /// Returns true if no code point straddles the code unit offset pos.
+  template <typename CharT>
+  inline bool is_code_point_boundary(std::basic_string_view<CharT> str, std::size_t pos) noexcept {
+    if (pos == 0 || pos >= str.size()) {
+      return true;
     }
-    else if constexpr (output_encoding == encoding::utf16) {
-      std::basic_string<output_char_type> output;
-      u32_to_u16(input_view.begin(), input_view.end(), std::back_inserter(output));
-      return output;
+
+    if constexpr (sizeof(CharT) == sizeof(char)) {
+      return !is_trail(str[pos]);
     }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return std::basic_string<output_char_type>(
-          reinterpret_cast<const output_char_type*>(input_view.data()), input_view.size());
+    else if constexpr (sizeof(CharT) == sizeof(char16_t)) {
+      return !(is_low_surrogate(static_cast<char16_t>(str[pos]))
+          && is_high_surrogate(static_cast<char16_t>(str[pos - 1])));
     }
     else {
-      return {};
+      return true;
     }
   }
-  else {
-    return {};
-  }
-}
-
-template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
-class convert {
-public:
-  using input_char_type = unicode::string_char_type_t<SType>;
-  static constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
-
-  inline convert(const SType& str)
-      : _input_view(str) {}
 
   template <typename CharT>
-  inline operator std::basic_string<CharT>() const {
-    return convert_as<CharT>(_input_view);
+  inline bool is_match(
+      std::basic_string_view<CharT> str, std::basic_string_view<CharT> needle, std::size_t pos) noexcept {
+    return str[pos + needle.size() - 1] == needle.back()
+        && std::char_traits<CharT>::compare(str.data() + pos, needle.data(), needle.size()) == 0
+        && is_code_point_boundary(str, pos) && is_code_point_boundary(str, pos + needle.size());
   }
 
-private:
-  std::basic_string_view<input_char_type> _input_view;
-};
+  /// memchr-style search: char_traits::find on the first code unit, then a check of the last code unit
+  /// before comparing the whole needle.
+  template <typename CharT>
+  inline std::size_t find_code_units(
+      std::basic_string_view<CharT> str, std::basic_string_view<CharT> needle, std::size_t pos) noexcept {
+    if (needle.empty()) {
+      return pos <= str.size() ? pos : string_view::npos;
+    }
 
-template <class SType>
-convert(const SType&) -> convert<SType>;
+    if (needle.size() > str.size()) {
+      return string_view::npos;
+    }
 
-template <class SType, class OutputIt, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
-inline OutputIt copy(const SType& str, OutputIt outputIt) {
+    const std::size_t last_pos = str.size() - needle.size();
 
-  using input_char_type = unicode::string_char_type_t<SType>;
-  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+    while (pos <= last_pos) {
+      const CharT* it = std::char_traits<CharT>::find(str.data() + pos, last_pos - pos + 1, needle.front());
 
-  using output_char_type = detail::output_iterator_value_type_t<OutputIt>;
-  constexpr encoding output_encoding = unicode::encoding_of<output_char_type>::value;
+      if (!it) {
+        return string_view::npos;
+      }
 
-  std::basic_string_view<input_char_type> input_view(str);
+      pos = static_cast<std::size_t>(it - str.data());
 
-  if constexpr (input_encoding == encoding::utf8) {
-    if constexpr (output_encoding == encoding::utf8) {
-      for (std::size_t i = 0; i < input_view.size(); i++) {
-        *outputIt++ = static_cast<output_char_type>(input_view[i]);
-      }
-      return outputIt;
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return u8_to_u16(input_view.begin(), input_view.end(), outputIt);
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return u8_to_u32(input_view.begin(), input_view.end(), outputIt);
-    }
-  }
-  else if constexpr (input_encoding == encoding::utf16) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return u16_to_u8(input_view.begin(), input_view.end(), outputIt);
-    }
-    else if constexpr (output_encoding == encoding::utf16) {
-      for (std::size_t i = 0; i < input_view.size(); i++) {
-        *outputIt++ = static_cast<output_char_type>(input_view[i]);
+      if (is_match(str, needle, pos)) {
+        return pos;
       }
-      return outputIt;
-    }
-    else if constexpr (output_encoding == encoding::utf32) {
-      return u16_to_u32(input_view.begin(), input_view.end(), outputIt);
+
+      pos++;
     }
+
+    return string_view::npos;
   }
-  else if constexpr (input_encoding == encoding::utf32) {
-    if constexpr (output_encoding == encoding::utf8) {
-      return u32_to_u8(input_view.begin(), input_view.end(), outputIt);
+
+  template <typename CharT>
+  inline std::size_t rfind_code_units(
+      std::basic_string_view<CharT> str, std::basic_string_view<CharT> needle, std::size_t pos) noexcept {
+    if (needle.size() > str.size()) {
+      return string_view::npos;
     }
-    else if constexpr (output_encoding == encoding::utf16) {
-      return u32_to_u16(input_view.begin(), input_view.end(), outputIt);
+
+    pos = (std::min)(pos, str.size() - needle.size());
+
+    if (needle.empty()) {
+      return pos;
     }
-    else if constexpr (output_encoding == encoding::utf32) {
-      for (std::size_t i = 0; i < input_view.size(); i++) {
-        *outputIt++ = static_cast<output_char_type>(input_view[i]);
+
+    for (std::size_t i = pos + 1; i-- > 0;) {
+      if (str[i] == needle.front() && is_match(str, needle, i)) {
+        return i;
       }
-      return outputIt;
     }
+
+    return string_view::npos;
   }
-}
 
-template <class SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
-inline std::size_t length(const SType& str) {
-  using input_char_type = unicode::string_char_type_t<SType>;
-  constexpr encoding input_encoding = unicode::encoding_of<input_char_type>::value;
+  /// Returns needle in the CharT encoding, converted into buffer when the encodings differ.
+  template <typename CharT>
+  inline std::basic_string_view<CharT> needle_as(const string_view& needle, std::basic_string<CharT>& buffer) {
+    if (needle.encoding() == encoding_of<CharT>::value) {
+      return needle.view<CharT>();
+    }
 
-  std::basic_string_view<input_char_type> input_view(str);
+    buffer = string_view_to_lossy<CharT>(needle, nullptr);
+    return buffer;
+  }
 
-  if constexpr (input_encoding == encoding::utf8) {
-    return u8_length(input_view.data(), input_view.size());
+  template <typename CharT>
+  inline std::size_t find(std::basic_string_view<CharT> str, const string_view& needle, std::size_t pos) {
+    std::basic_string<CharT> buffer;
+    return find_code_units(str, needle_as<CharT>(needle, buffer), pos);
   }
-  else if constexpr (input_encoding == encoding::utf16) {
-    return u16_length(input_view.data(), input_view.size());
+
+  template <typename CharT>
+  inline std::size_t rfind(std::basic_string_view<CharT> str, const string_view& needle, std::size_t pos) {
+    std::basic_string<CharT> buffer;
+    return rfind_code_units(str, needle_as<CharT>(needle, buffer), pos);
   }
-  else if constexpr (input_encoding == encoding::utf32) {
-    return u32_length(input_view.data(), input_view.size());
+
+  template <typename CharT>
+  inline bool starts_with(std::basic_string_view<CharT> str, const string_view& prefix) {
+    std::basic_string<CharT> buffer;
+    const std::basic_string_view<CharT> p = needle_as<CharT>(prefix, buffer);
+    return str.substr(0, p.size()) == p && is_code_point_boundary(str, p.size());
   }
-  else {
-    return 0;
+
+  template <typename CharT>
+  inline bool ends_with(std::basic_string_view<CharT> str, const string_view& suffix) {
+    std::basic_string<CharT> buffer;
+    const std::basic_string_view<CharT> s = needle_as<CharT>(suffix, buffer);
+    return s.size() <= str.size() && str.substr(str.size() - s.size()) == s
+        && is_code_point_boundary(str, str.size() - s.size());
   }
+} // namespace detail.
+
+std::size_t string_view::find(const string_view& needle, std::size_t pos) const {
+  return visit([&](auto str) { return detail::find(str, needle, pos); });
+}
+
+std::size_t string_view::rfind(const string_view& needle, std::size_t pos) const {
+  return visit([&](auto str) { return detail::rfind(str, needle, pos); });
+}
+
+bool string_view::starts_with(const string_view& prefix) const {
+  return visit([&](auto str) { return detail::starts_with(str, prefix); });
+}
+
+bool string_view::ends_with(const string_view& suffix) const {
+  return visit([&](auto str) { return detail::ends_with(str, suffix); });
 }
 
 namespace detail {
-  template <encoding Encoding = encoding::utf8>
-  struct iterator_sequence_length {
+  /// Returns true if any byte of word is equal to byte.
+  inline constexpr bool has_byte(std::uint64_t word, std::uint32_t byte) noexcept {
+    const std::uint64_t x = word ^ (0x0101010101010101ull * byte);
+    return ((x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull) != 0;
+  }
 
-    template <typename T>
-    static inline constexpr std::size_t length(T lead) noexcept {
-      return sequence_length(static_cast<std::uint8_t>(lead));
+  /// Returns the offset of the first code unit at or after pos that is one of units, or str.size().
+  /// With utf8, 8 bytes are tested at a time.
+  template <typename CharT>
+  inline std::size_t find_first_unit_of(
+      std::basic_string_view<CharT> str, std::size_t pos, const std::uint32_t* units, std::size_t count) noexcept {
+    if constexpr (sizeof(CharT) == sizeof(char)) {
+      for (; pos + sizeof(std::uint64_t) <= str.size(); pos += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, str.data() + pos, sizeof(word));
+
+        bool found = false;
+        for (std::size_t i = 0; i < count; i++) {
+          found |= has_byte(word, units[i]);
+        }
+
+        if (found) {
+          break;
+        }
+      }
     }
-  };
 
-  template <>
-  struct iterator_sequence_length<encoding::utf16> {
+    for (; pos < str.size(); pos++) {
+      const std::uint32_t c = static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<CharT>>(str[pos]));
 
-    template <typename T>
-    static inline constexpr std::size_t length(T c) noexcept {
-      return u16_sequence_length(static_cast<char16_t>(c));
+      for (std::size_t i = 0; i < count; i++) {
+        if (c == units[i]) {
+          return pos;
+        }
+      }
     }
-  };
 
-  template <>
-  struct iterator_sequence_length<encoding::utf32> {
+    return str.size();
+  }
 
-    template <typename T>
-    static inline constexpr std::size_t length(T) noexcept {
-      return 1;
-    }
-  };
+  /// Returns true if cp is one of the code points of set.
+  inline bool contains_code_point(const string_view& set, std::uint32_t cp) noexcept {
+    return set.visit([cp](auto str) {
+      using char_type = typename decltype(str)::value_type;
+      const char_type* it = str.data();
+      const char_type* end = str.data() + str.size();
+
+      while (it != end) {
+        std::uint32_t c;
+        if (decode_next<encoding_of<char_type>::value>(it, end, c) == error_code::none && c == cp) {
+          return true;
+        }
+      }
 
-  template <typename InputCharT, typename OutputChart, typename = void>
-  struct base_iterator {};
+      return false;
+    });
+  }
+} // namespace detail.
 
-  template <typename InputCharT, typename OutputCharT>
-  struct base_iterator<InputCharT, OutputCharT,
-      std::enable_if_t<encoding_of<InputCharT>::value == encoding_of<OutputCharT>::value>> {
+split_range::split_range(string_view str, mode m, char32_t delimiter, string_view delimiters) noexcept
+    : m_str(str)
+    , m_delimiters(delimiters)
+    , m_mode(m)
+    , m_delimiter(delimiter) {
+  switch (m_mode) {
+  case mode::code_point:
+    add_delimiter(static_cast<std::uint32_t>(delimiter));
+    break;
 
-    using input_char_type = InputCharT;
-    using output_char_type = OutputCharT;
+  case mode::lines:
+    add_delimiter(0x0A);
+    add_delimiter(0x0D);
+    add_delimiter(0x2028);
+    add_delimiter(0x2029);
+    break;
 
-    using input_view_type = std::basic_string_view<input_char_type>;
-    using output_view_type = std::basic_string_view<output_char_type>;
+  case mode::any:
+    delimiters.visit([this](auto set) {
+      using char_type = typename decltype(set)::value_type;
+      const char_type* it = set.data();
+      const char_type* end = set.data() + set.size();
 
-    using it_seq_length = detail::iterator_sequence_length<encoding_of<InputCharT>::value>;
+      while (it != end) {
+        std::uint32_t cp;
+        if (detail::decode_next<encoding_of<char_type>::value>(it, end, cp) == error_code::none) {
+          add_delimiter(cp);
 
-    template <typename Iterator>
-    static inline output_view_type get(Iterator it) {
-      return output_view_type(reinterpret_cast<const output_char_type*>(&(it[0])), it_seq_length::length(*it));
-    }
+          if (m_code_point_count < m_code_points.size()) {
+            m_code_points[m_code_point_count] = cp;
+          }
 
-    template <typename Iterator>
-    static inline void advance(Iterator& it) {
-      //  using value_type = unicode::detail::output_iterator_value_type_t<u16_iterator>;
-      using it_diff_type = typename std::iterator_traits<Iterator>::difference_type;
-      std::advance(it, static_cast<it_diff_type>(it_seq_length::length(*it)));
-    }
-  };
+          m_code_point_count++;
+        }
+      }
+    });
+    break;
+  }
+}
 
-  template <typename InputCharT, typename OutputCharT>
-  struct base_iterator<InputCharT, OutputCharT,
-      std::enable_if_t<encoding_of<InputCharT>::value != encoding_of<OutputCharT>::value>> {
+void split_range::add_delimiter(std::uint32_t cp) noexcept {
+  // Once there are too many different first code units, every code unit is a candidate.
+  if (m_unit_count == m_units.size() + 1) {
+    return;
+  }
 
-    using input_char_type = InputCharT;
-    using output_char_type = OutputCharT;
+  const std::uint32_t unit = m_str.visit([cp](auto str) {
+    using char_type = typename decltype(str)::value_type;
+    std::array<char_type, 4> buffer = {};
+    detail::append_code_point<encoding_of<char_type>::value>(cp, buffer.data());
+    return static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<char_type>>(buffer[0]));
+  });
 
-    using input_view_type = std::basic_string_view<input_char_type>;
-    using output_view_type = std::basic_string_view<output_char_type>;
+  if (std::find(m_units.begin(), m_units.begin() + m_unit_count, unit) != m_units.begin() + m_unit_count) {
+    return;
+  }
 
-    using it_seq_length = detail::iterator_sequence_length<encoding_of<InputCharT>::value>;
+  if (m_unit_count == m_units.size()) {
+    m_unit_count = m_units.size() + 1;
+    return;
+  }
 
-    template <typename Iterator>
-    inline output_view_type get(Iterator it) const {
-      return output_view_type(_data.begin(),
-          static_cast<std::size_t>(std::distance(
-              _data.begin(), unicode::copy(input_view_type(&it[0], it_seq_length::length(*it)), _data.begin()))));
-    }
+  m_units[m_unit_count++] = unit;
+}
 
-    template <typename Iterator>
-    inline void advance(Iterator& it) {
-      using it_diff_type = typename std::iterator_traits<Iterator>::difference_type;
-      std::advance(it, static_cast<it_diff_type>(it_seq_length::length(*it)));
-    }
+bool split_range::is_delimiter(std::uint32_t cp) const noexcept {
+  switch (m_mode) {
+  case mode::code_point:
+    return cp == static_cast<std::uint32_t>(m_delimiter);
 
-    mutable std::array<output_char_type, encoding_to_max_char_count<encoding_of<OutputCharT>::value>::value> _data;
-  };
+  case mode::lines:
+    return cp == 0x0A || cp == 0x0D || cp == 0x2028 || cp == 0x2029;
 
-  template <class IteratorType>
-  using iterator_value_type = unicode::remove_cvref_t<decltype(std::declval<IteratorType>()[0])>;
+  case mode::any:
+    if (m_code_point_count > m_code_points.size()) {
+      return detail::contains_code_point(m_delimiters, cp);
+    }
 
-  template <class IteratorType>
-  using iterator_base_type = basic_iterator<iterator_value_type<IteratorType>,
-      std::basic_string_view<iterator_value_type<IteratorType>>, IteratorType>;
+    return std::find(m_code_points.begin(), m_code_points.begin() + m_code_point_count, cp)
+        != m_code_points.begin() + m_code_point_count;
+  }
 
-  template <typename IteratorT>
-  class iterator_range {
-    IteratorT _begin_iterator;
-    IteratorT _end_iterator;
+  return false;
+}
 
-  public:
-    template <typename Container>
-    inline iterator_range(Container&& c)
-        : _begin_iterator(c.begin())
-        , _end_iterator(c.end()) {}
+std::pair<std::size_t, std::size_t> split_range::find_delimiter(std::size_t pos) const noexcept {
+  return m_str.visit([&](auto str) -> std::pair<std::size_t, std::size_t> {
+    using char_type = typename decltype(str)::value_type;
+    const std::size_t unit_count = m_unit_count > m_units.size() ? 0 : m_unit_count;
 
-    inline iterator_range(IteratorT begin_iterator, IteratorT end_iterator)
-        : _begin_iterator(std::move(begin_iterator))
-        , _end_iterator(std::move(end_iterator)) {}
+    for (; pos < str.size(); pos++) {
+      if (unit_count) {
+        pos = detail::find_first_unit_of(str, pos, m_units.data(), unit_count);
 
-    inline IteratorT begin() const { return _begin_iterator; }
-    inline IteratorT end() const { return _end_iterator; }
-    inline bool empty() const { return _begin_iterator == _end_iterator; }
-  };
+        if (pos == str.size()) {
+          break;
+        }
+      }
 
-} // namespace detail.
+      if (!detail::is_code_point_boundary(str, pos)) {
+        continue;
+      }
 
-NANO_UNICODE_CLANG_PUSH_WARNING("-Wpadded")
-template <class CharT, class SType, class IteratorType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
-class basic_iterator : private detail::base_iterator<unicode::string_char_type_t<SType>, CharT> {
-  using base_type = detail::base_iterator<unicode::string_char_type_t<SType>, CharT>;
-  using output_view_type = typename base_type::output_view_type;
+      const char_type* it = str.data() + pos;
+      const char_type* end = str.data() + str.size();
+      std::uint32_t cp;
 
-  template <class T>
-  friend class iterator;
+      if (detail::decode_next<encoding_of<char_type>::value>(it, end, cp) != error_code::none || !is_delimiter(cp)) {
+        continue;
+      }
 
-public:
-  typedef std::ptrdiff_t difference_type;
-  typedef std::forward_iterator_tag iterator_category;
+      // CRLF is a single line break.
+      if (m_mode == mode::lines && cp == 0x0D && it != end && *it == 0x0A) {
+        ++it;
+      }
 
-  inline basic_iterator() = default;
+      return { pos, static_cast<std::size_t>(it - (str.data() + pos)) };
+    }
 
-  inline explicit basic_iterator(IteratorType it)
-      : _it(it) {}
+    return { string_view::npos, 0 };
+  });
+}
 
-  inline IteratorType base() const { return _it; }
+split_range::iterator split_range::begin() const noexcept {
+  // Lines of an empty string are empty, but splitting it gives a single empty piece.
+  if (m_mode == mode::lines && m_str.empty()) {
+    return end();
+  }
 
-  inline output_view_type operator*() const { return base_type::get(_it); }
+  return iterator(this, 0);
+}
 
-  inline bool operator==(const basic_iterator& rhs) const { return (_it == rhs._it); }
+split_range::iterator::iterator(const split_range* range, std::size_t pos) noexcept
+    : m_range(range)
+    , m_pos(pos) {
+  find_end();
+}
 
-  inline bool operator!=(const basic_iterator& rhs) const { return !(operator==(rhs)); }
+void split_range::iterator::find_end() noexcept {
+  const auto [pos, size] = m_range->find_delimiter(m_pos);
 
-  inline basic_iterator& operator++() {
-    base_type::advance(_it);
-    return *this;
+  if (pos == string_view::npos) {
+    m_end = m_range->m_str.size();
+    m_next = string_view::npos;
   }
-
-  inline basic_iterator operator++(int) {
-    basic_iterator temp = *this;
-    base_type::advance(_it);
-    return temp;
+  else {
+    m_end = pos;
+    m_next = pos + size;
   }
+}
 
-private:
-  IteratorType _it;
-};
-NANO_UNICODE_CLANG_POP_WARNING()
+string_view split_range::iterator::operator*() const noexcept { return detail::sub_view(m_range->m_str, m_pos, m_end); }
 
-template <typename CharT, typename SType>
-inline auto iterate_as(const SType& str) {
-  return detail::iterator_range<basic_iterator<CharT, SType, typename SType::const_iterator>>(str);
-}
+split_range::iterator& split_range::iterator::operator++() noexcept {
+  if (m_next == string_view::npos
+      || (m_range->m_mode == split_range::mode::lines && m_next == m_range->m_str.size())) {
+    m_pos = string_view::npos;
+    return *this;
+  }
 
-template <typename SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
-inline auto iterate(const SType& str) {
-  return detail::iterator_range<basic_iterator<string_char_type_t<SType>, SType, typename SType::const_iterator>>(str);
+  m_pos = m_next;
+  find_end();
+  return *this;
 }
 
-template <class IteratorType>
-class iterator : private detail::iterator_base_type<IteratorType> {
-  using base_type = detail::iterator_base_type<IteratorType>;
+namespace detail {
+  /// Returns the size of the longest prefix of str that needs at most max_units code units in
+  /// the Target encoding. Ascii runs are skipped with the word scan of ascii_prefix_length().
+  template <encoding Target, typename CharT>
+  inline std::size_t fitting_prefix_size(std::basic_string_view<CharT> str, std::size_t max_units) noexcept {
+    if constexpr (Target == encoding_of<CharT>::value) {
+      if (str.size() <= max_units) {
+        return str.size();
+      }
 
-public:
-  typedef std::ptrdiff_t difference_type;
-  typedef std::forward_iterator_tag iterator_category;
+      // A well-formed sequence starts at most 3 code units back.
+      std::size_t pos = max_units;
+      for (std::size_t i = 0; i < 3 && !is_code_point_boundary(str, pos); i++) {
+        pos--;
+      }
 
-  inline iterator() = default;
+      return is_code_point_boundary(str, pos) ? pos : max_units;
+    }
+    else {
+      const CharT* it = str.data();
+      const CharT* end = str.data() + str.size();
+      std::size_t units = 0;
+
+      while (it != end && units < max_units) {
+        const std::size_t ascii_size
+            = (std::min)(ascii_prefix_length(it, static_cast<std::size_t>(end - it)), max_units - units);
+        it += ascii_size;
+        units += ascii_size;
+
+        if (it == end || units == max_units) {
+          break;
+        }
+
+        const CharT* next = it;
+        std::uint32_t cp;
+        if (decode_next<encoding_of<CharT>::value>(next, end, cp) != error_code::none) {
+          cp = k_replacement_character;
+        }
+
+        const std::size_t size = Target == encoding::utf8 ? code_point_size_u8(cp)
+            : Target == encoding::utf16                  ? (cp > 0xFFFF ? 2 : 1)
+                                                         : 1;
+
+        if (units + size > max_units) {
+          break;
+        }
+
+        units += size;
+        it = next;
+      }
 
-  inline explicit iterator(IteratorType it)
-      : _it(it) {}
+      return static_cast<std::size_t>(it - str.data());
+    }
+  }
+} // namespace detail.
 
-  inline IteratorType base() const { return _it; }
+string_view truncate_to_units(const string_view& s, std::size_t max_units) noexcept {
+  return truncate_to_units(s, max_units, s.encoding());
+}
 
-  inline typename base_type::output_view_type operator*() const { return base_type::get(_it); }
+string_view truncate_to_units(const string_view& s, std::size_t max_units, encoding target) noexcept {
+  const std::size_t size = s.visit([&](auto str) {
+    switch (target) {
+    case encoding::utf8:
+      return detail::fitting_prefix_size<encoding::utf8>(str, max_units);
 
-  inline bool operator==(const iterator& rhs) const { return (_it == rhs._it); }
+    case encoding::utf16:
+      return detail::fitting_prefix_size<encoding::utf16>(str, max_units);
 
-  inline bool operator!=(const iterator& rhs) const { return !(operator==(rhs)); }
+    default:
+      return detail::fitting_prefix_size<encoding::utf32>(str, max_units);
+    }
+  });
 
-  inline iterator& operator++() {
-    base_type::advance(_it);
+  return detail::sub_view(s, 0, size);
+}
+
+chunk_range::iterator::iterator(string_view str, std::size_t max_units, encoding target) noexcept
+    : m_rest(str)
+    , m_max_units(max_units)
+    , m_target(target) {
+  ++(*this);
+}
+
+chunk_range::iterator& chunk_range::iterator::operator++() noexcept {
+  if (m_rest.empty()) {
+    m_chunk = string_view();
     return *this;
   }
 
-  inline iterator operator++(int) {
-    iterator temp = *this;
-    base_type::advance(_it);
-    return temp;
+  std::size_t size = truncate_to_units(m_rest, m_max_units, m_target).size();
+
+  if (size == 0) {
+    size = m_rest.visit([](auto str) { return detail::advance_code_points(str, 0, 1); });
   }
 
-private:
-  IteratorType _it;
-};
+  m_chunk = detail::sub_view(m_rest, 0, size);
+  m_rest = detail::sub_view(m_rest, size, m_rest.size());
+  return *this;
+}
 
-template <class IteratorType>
-iterator(IteratorType) -> iterator<IteratorType>;
+chunk_range chunks(const string_view& s, std::size_t max_units) noexcept {
+  return chunk_range(s, max_units, s.encoding());
+}
 
-//
-//
-//
-template <typename T, std::enable_if_t<is_string_type<remove_cvref_t<T>>::value, std::nullptr_t>>
-string_view::string_view(T&& s)
-    : string_view(make<T>(std::forward<T>(s))) {
-  (void)m_reserved;
+chunk_range chunks(const string_view& s, std::size_t max_units, encoding target) noexcept {
+  return chunk_range(s, max_units, target);
 }
 
-string_view::string_view() noexcept
-    : m_data()
-    , m_size(0)
-    , m_charSize(sizeof(char))
-    , m_nullTerminated(false) {}
+template <typename CharT>
+basic_code_point_range<CharT>::iterator::iterator(const CharT* it, const CharT* end) noexcept
+    : m_it(it)
+    , m_next(it)
+    , m_end(end) {
+  if (m_next != m_end) {
+    m_cp = detail::decode_or_replace(m_next, m_end);
+  }
+}
 
-string_view::string_view(const std::string& str, normal_tag) noexcept
-    : m_data{ str.c_str() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char))
-    , m_nullTerminated(true) {}
+template <typename CharT>
+typename basic_code_point_range<CharT>::iterator& basic_code_point_range<CharT>::iterator::operator++() noexcept {
+  m_it = m_next;
 
-string_view::string_view(const std::u16string& str, normal_tag) noexcept
-    : m_data{ str.c_str() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char16_t))
-    , m_nullTerminated(true) {}
+  if (m_next != m_end) {
+    m_cp = detail::decode_or_replace(m_next, m_end);
+  }
 
-string_view::string_view(const std::u32string& str, normal_tag) noexcept
-    : m_data{ str.c_str() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char32_t))
-    , m_nullTerminated(true) {}
+  return *this;
+}
 
-string_view::string_view(const std::wstring& str, normal_tag) noexcept
-    : m_data{ str.c_str() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(wchar_t))
-    , m_nullTerminated(true) {}
+code_point_range::iterator::iterator(string_view str, std::size_t pos) noexcept
+    : m_str(str)
+    , m_pos(pos)
+    , m_next(pos) {
+  decode();
+}
 
-string_view::string_view(std::string_view str, normal_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char))
-    , m_nullTerminated(false) {}
+void code_point_range::iterator::decode() noexcept {
+  if (m_next == m_str.size()) {
+    return;
+  }
 
-string_view::string_view(std::u16string_view str, normal_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char16_t))
-    , m_nullTerminated(false) {}
+  m_str.visit([this](auto str) {
+    using char_type = typename decltype(str)::value_type;
+    const char_type* it = str.data() + m_next;
+    m_cp = detail::decode_or_replace(it, str.data() + str.size());
+    m_next = static_cast<std::size_t>(it - str.data());
+  });
+}
 
-string_view::string_view(std::u32string_view str, normal_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char32_t))
-    , m_nullTerminated(false) {}
+code_point_range::iterator& code_point_range::iterator::operator++() noexcept {
+  m_pos = m_next;
+  decode();
+  return *this;
+}
 
-string_view::string_view(std::wstring_view str, normal_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(wchar_t))
-    , m_nullTerminated(false) {}
+template <typename SType, std::enable_if_t<is_string_type<SType>::value, std::nullptr_t>>
+basic_code_point_range<string_char_type_t<SType>> code_points(const SType& str) noexcept {
+  using char_type = string_char_type_t<SType>;
+  return basic_code_point_range<char_type>(std::basic_string_view<char_type>(str));
+}
 
-string_view::string_view(std::string_view str, null_terminated_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char))
-    , m_nullTerminated(true) {}
+code_point_range code_points(const string_view& str) noexcept { return code_point_range(str); }
 
-string_view::string_view(std::u16string_view str, null_terminated_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char16_t))
-    , m_nullTerminated(true) {}
+template <typename CharT>
+void block_range<CharT>::decode(std::size_t pos) noexcept {
+  m_str.visit([&](auto str) {
+    constexpr encoding output_encoding = encoding_of<CharT>::value;
+    const auto* first = str.data();
+    const auto* end = first + str.size();
+    const auto* it = first + pos;
+
+    CharT* out = m_block.m_units;
+    std::size_t count = 0;
+
+    while (count < m_block_size && it != end) {
+      // Ascii runs are copied with a plain widening or narrowing loop.
+      const std::size_t ascii_size = detail::ascii_prefix_length(
+          it, (std::min)(static_cast<std::size_t>(end - it), m_block_size - count));
+
+      for (std::size_t i = 0; i < ascii_size; i++) {
+        m_block.m_offsets[count + i] = pos + i;
+        out[i] = static_cast<CharT>(it[i]);
+      }
 
-string_view::string_view(std::u32string_view str, null_terminated_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(char32_t))
-    , m_nullTerminated(true) {}
+      it += ascii_size;
+      out += ascii_size;
+      count += ascii_size;
+      pos += ascii_size;
 
-string_view::string_view(std::wstring_view str, null_terminated_tag) noexcept
-    : m_data{ str.data() }
-    , m_size(static_cast<std::uint32_t>(str.size()))
-    , m_charSize(sizeof(wchar_t))
-    , m_nullTerminated(true) {}
+      if (count == m_block_size || it == end) {
+        break;
+      }
 
-string_view::content::content() noexcept
-    : c8(nullptr) {}
+      m_block.m_offsets[count++] = pos;
+      out = detail::append_code_point<output_encoding>(detail::decode_or_replace(it, end), out);
+      pos = static_cast<std::size_t>(it - first);
+    }
 
-string_view::content::content(const char* s) noexcept
-    : c8(s) {}
+    m_block.m_offsets[count] = pos;
+    m_block.m_unit_count = static_cast<std::size_t>(out - m_block.m_units);
+    m_block.m_size = count;
+  });
+}
 
-string_view::content::content(const char16_t* s) noexcept
-    : c16(s) {}
+template <typename CharT>
+block_range<CharT> decode_blocks(const string_view& s, std::size_t block_size) noexcept {
+  return block_range<CharT>(s, block_size);
+}
 
-string_view::content::content(const char32_t* s) noexcept
-    : c32(s) {}
+namespace detail {
+  /// Returns the size of the incomplete sequence at the end of [str, str + size), which another
+  /// chunk could complete. Returns 0 when the last sequence is complete or can't be completed.
+  template <encoding Encoding, typename CharT>
+  inline std::size_t incomplete_tail_size(const CharT* str, std::size_t size) noexcept {
+    constexpr std::size_t max_tail = encoding_to_max_char_count<Encoding>::value - 1;
+
+    for (std::size_t n = 1; n <= max_tail && n <= size; n++) {
+      const CharT* it = str + size - n;
+      std::uint32_t cp = 0;
+
+      if (decode_next<Encoding>(it, str + size, cp) == error_code::truncated && it == str + size) {
+        return n;
+      }
 
-string_view::content::content(const wchar_t* s) noexcept
-    : content([](const wchar_t* ws) {
-      if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
-        return content(reinterpret_cast<const char16_t*>(ws));
+      // Only a utf8 continuation byte can be preceded by the start of the sequence.
+      if constexpr (Encoding == encoding::utf8) {
+        if (!is_trail(str[size - n])) {
+          break;
+        }
       }
       else {
-        return content(reinterpret_cast<const char32_t*>(ws));
+        break;
       }
-    }(s)) {}
+    }
 
-const wchar_t* string_view::content::cw() const noexcept {
-  if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
-    return reinterpret_cast<const wchar_t*>(c16);
+    return 0;
   }
-  else {
-    return reinterpret_cast<const wchar_t*>(c32);
+} // namespace detail.
+
+template <typename From, typename To>
+template <class OutputIt>
+OutputIt transcoder<From, To>::feed(std::basic_string_view<From> chunk, OutputIt outputIt) {
+  constexpr encoding input_encoding = encoding_of<From>::value;
+  constexpr encoding output_encoding = encoding_of<To>::value;
+  static_assert(encoding_of<detail::output_iterator_value_type_t<OutputIt>>::value == output_encoding,
+      "The output iterator should write To code units.");
+
+  if constexpr (max_pending != 0) {
+    if (m_pending_size) {
+      // Completes the pending sequence with the first units of chunk.
+      std::array<From, max_pending + 1> buffer = {};
+      const std::size_t taken = (std::min)(chunk.size(), buffer.size() - m_pending_size);
+      std::copy_n(m_pending.data(), m_pending_size, buffer.data());
+      std::copy_n(chunk.data(), taken, buffer.data() + m_pending_size);
+
+      const From* it = buffer.data();
+      const From* end = buffer.data() + m_pending_size + taken;
+      std::uint32_t cp = 0;
+      const error_code code = detail::decode_next<input_encoding>(it, end, cp);
+
+      if (code == error_code::truncated && it == end) {
+        // Still incomplete, all of chunk was taken.
+        m_pending_size += taken;
+        std::copy_n(buffer.data(), m_pending_size, m_pending.data());
+        return outputIt;
+      }
+
+      if (code != error_code::none) {
+        cp = detail::k_replacement_character;
+        m_replacements++;
+      }
+
+      outputIt = detail::append_code_point<output_encoding>(cp, outputIt);
+      chunk.remove_prefix(static_cast<std::size_t>(it - buffer.data()) - m_pending_size);
+      m_pending_size = 0;
+    }
+
+    const std::size_t tail = detail::incomplete_tail_size<input_encoding>(chunk.data(), chunk.size());
+    std::copy_n(chunk.data() + chunk.size() - tail, tail, m_pending.data());
+    m_pending_size = tail;
+    chunk.remove_suffix(tail);
   }
+
+  // The bulk of the chunk goes through the regular converters.
+  std::size_t count = 0;
+  outputIt = copy_lossy(chunk, outputIt, &count);
+  m_replacements += count;
+  return outputIt;
 }
 
-enum encoding string_view::encoding() const noexcept {
-  switch (char_size()) {
-  case sizeof(char):
-    return encoding::utf8;
-  case sizeof(char16_t):
-    return encoding::utf16;
-  case sizeof(char32_t):
-    return encoding::utf32;
-  default:
-    return encoding::utf8;
+template <typename From, typename To>
+template <class OutputIt>
+OutputIt transcoder<From, To>::finish(OutputIt outputIt) {
+  if (m_pending_size) {
+    // A valid but incomplete sequence is a single maximal subpart.
+    outputIt = detail::append_code_point<encoding_of<To>::value>(detail::k_replacement_character, outputIt);
+    m_replacements++;
+    m_pending_size = 0;
   }
+
+  return outputIt;
 }
 
-template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
-const CharT* string_view::c_str() const noexcept {
-  if constexpr (std::is_same_v<CharT, char>) {
-    return (m_charSize == sizeof(char) && m_nullTerminated) ? m_data.c8 : nullptr;
-  }
+template <typename From, typename To>
+transcoding_streambuf<From, To>::transcoding_streambuf(std::streambuf* target) noexcept
+    : m_target(target) {
+  // The last slot is kept for the character given to overflow().
+  this->setp(m_put.data(), m_put.data() + m_put.size() - 1);
+  this->setg(m_get.data(), m_get.data(), m_get.data());
+}
 
-  else if constexpr (std::is_same_v<CharT, char16_t>) {
-    return (m_charSize == sizeof(char16_t) && m_nullTerminated) ? m_data.c16 : nullptr;
+template <typename From, typename To>
+transcoding_streambuf<From, To>::~transcoding_streambuf() {
+  if (flush_put_area()) {
+    write_converted(m_encoder.finish(m_put_converted.data()));
+    m_target->pubsync();
   }
+}
 
-  else if constexpr (std::is_same_v<CharT, char32_t>) {
-    return (m_charSize == sizeof(char32_t) && m_nullTerminated) ? m_data.c32 : nullptr;
+template <typename From, typename To>
+typename transcoding_streambuf<From, To>::int_type transcoding_streambuf<From, To>::overflow(int_type c) {
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *this->pptr() = traits_type::to_char_type(c);
+    this->pbump(1);
   }
 
-  else if constexpr (std::is_same_v<CharT, wchar_t>) {
-    return (m_charSize == sizeof(wchar_t) && m_nullTerminated) ? m_data.cw() : nullptr;
-  }
+  return flush_put_area() ? traits_type::not_eof(c) : traits_type::eof();
+}
 
-  else {
-    // Should never happen.
-    return nullptr;
-  }
+template <typename From, typename To>
+int transcoding_streambuf<From, To>::sync() {
+  // An incomplete sequence stays in the encoder until the next write completes it.
+  return flush_put_area() && m_target->pubsync() == 0 ? 0 : -1;
 }
 
-template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
-const CharT* string_view::data() const noexcept {
-  if constexpr (std::is_same_v<CharT, char>) {
-    return (m_charSize == sizeof(char)) ? m_data.c8 : nullptr;
+template <typename From, typename To>
+typename transcoding_streambuf<From, To>::int_type transcoding_streambuf<From, To>::underflow() {
+  if (this->gptr() < this->egptr()) {
+    return traits_type::to_int_type(*this->gptr());
   }
 
-  else if constexpr (std::is_same_v<CharT, char16_t>) {
-    return (m_charSize == sizeof(char16_t)) ? m_data.c16 : nullptr;
+  if (!m_target) {
+    return traits_type::eof();
   }
 
-  else if constexpr (std::is_same_v<CharT, char32_t>) {
-    return (m_charSize == sizeof(char32_t)) ? m_data.c32 : nullptr;
-  }
+  From* last = m_get.data();
 
-  else if constexpr (std::is_same_v<CharT, wchar_t>) {
-    return (m_charSize == sizeof(wchar_t)) ? m_data.cw() : nullptr;
-  }
+  // A block can end with an incomplete sequence that converts to nothing.
+  while (last == m_get.data() && !m_get_eof) {
+    const std::streamsize size = m_target->sgetn(m_get_raw.data() + m_get_raw_size,
+        static_cast<std::streamsize>(m_get_raw.size() - m_get_raw_size));
 
-  else {
-    // Should never happen.
-    return nullptr;
-  }
-}
+    if (size <= 0) {
+      m_get_eof = true;
+      last = m_decoder.finish(last);
 
-template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
-std::basic_string<CharT> string_view::str() const {
-  using stype = std::basic_string<CharT>;
+      if (m_get_raw_size) {
+        // A partial code unit at the end of the target.
+        last = detail::append_code_point<encoding_of<From>::value>(detail::k_replacement_character, last);
+        m_get_raw_size = 0;
+        m_partial_units++;
+      }
 
-  if constexpr (std::is_same_v<CharT, char>) {
-    return (m_charSize == sizeof(char)) ? stype(m_data.c8, m_size) : stype();
-  }
+      break;
+    }
 
-  else if constexpr (std::is_same_v<CharT, char16_t>) {
-    return (m_charSize == sizeof(char16_t)) ? stype(m_data.c16, m_size) : stype();
-  }
+    m_get_raw_size += static_cast<std::size_t>(size);
+    const std::size_t unit_count = m_get_raw_size / sizeof(To);
 
-  else if constexpr (std::is_same_v<CharT, char32_t>) {
-    return (m_charSize == sizeof(char32_t)) ? stype(m_data.c32, m_size) : stype();
-  }
+    // Copied out of the byte buffer rather than aliased.
+    std::array<To, block_size> units;
+    std::memcpy(units.data(), m_get_raw.data(), unit_count * sizeof(To));
+    last = m_decoder.feed(std::basic_string_view<To>(units.data(), unit_count), last);
 
-  else if constexpr (std::is_same_v<CharT, wchar_t>) {
-    return (m_charSize == sizeof(wchar_t)) ? stype(m_data.cw(), m_size) : stype();
+    m_get_raw_size -= unit_count * sizeof(To);
+    std::memmove(m_get_raw.data(), m_get_raw.data() + unit_count * sizeof(To), m_get_raw_size);
   }
 
-  else {
-    // Should never happen.
-    return stype();
+  this->setg(m_get.data(), m_get.data(), last);
+  return last == m_get.data() ? traits_type::eof() : traits_type::to_int_type(*this->gptr());
+}
+
+template <typename From, typename To>
+bool transcoding_streambuf<From, To>::flush_put_area() {
+  if (!m_target) {
+    return false;
   }
+
+  const std::basic_string_view<From> block(this->pbase(), static_cast<std::size_t>(this->pptr() - this->pbase()));
+  this->setp(m_put.data(), m_put.data() + m_put.size() - 1);
+  return block.empty() || write_converted(m_encoder.feed(block, m_put_converted.data()));
 }
 
-template <typename CharT, std::enable_if_t<is_char_type<CharT>::value, std::nullptr_t>>
-std::basic_string_view<CharT> string_view::view() const {
-  using svtype = std::basic_string_view<CharT>;
+template <typename From, typename To>
+bool transcoding_streambuf<From, To>::write_converted(const To* last) {
+  const std::streamsize size
+      = static_cast<std::streamsize>(last - m_put_converted.data()) * static_cast<std::streamsize>(sizeof(To));
+  return size == 0 || m_target->sputn(reinterpret_cast<const char*>(m_put_converted.data()), size) == size;
+}
 
-  if constexpr (std::is_same_v<CharT, char>) {
-    return (m_charSize == sizeof(char)) ? svtype(m_data.c8, m_size) : svtype();
+namespace detail {
+  /// Number of bytes looked at by detect_encoding() when there's no byte order mark.
+  inline constexpr std::size_t k_detect_encoding_prefix_size = 4096;
+
+  inline bool is_little_endian() noexcept {
+    const std::uint16_t value = 1;
+    std::uint8_t first;
+    std::memcpy(&first, &value, 1);
+    return first == 1;
   }
 
-  else if constexpr (std::is_same_v<CharT, char16_t>) {
-    return (m_charSize == sizeof(char16_t)) ? svtype(m_data.c16, m_size) : svtype();
-  }
+  /// Counts the zero bytes of [data, data + size) by position modulo 4, a word at a time.
+  inline std::array<std::size_t, 4> count_zero_bytes(const char* data, std::size_t size) noexcept {
+    constexpr std::uint64_t low_bits = 0x7F7F7F7F7F7F7F7Full;
 
-  else if constexpr (std::is_same_v<CharT, char32_t>) {
-    return (m_charSize == sizeof(char32_t)) ? svtype(m_data.c32, m_size) : svtype();
-  }
+    // Byte k of a word goes to column k % 4 whatever the host byte order.
+    std::array<std::uint64_t, 4> columns;
+    for (std::size_t j = 0; j < columns.size(); j++) {
+      std::array<std::uint8_t, sizeof(std::uint64_t)> column_bytes = {};
+      column_bytes[j] = column_bytes[j + 4] = 0x80;
+      std::memcpy(&columns[j], column_bytes.data(), sizeof(std::uint64_t));
+    }
 
-  else if constexpr (std::is_same_v<CharT, wchar_t>) {
-    return (m_charSize == sizeof(wchar_t)) ? svtype(m_data.cw(), m_size) : svtype();
-  }
+    std::array<std::size_t, 4> zeros = {};
+    std::size_t i = 0;
 
-  else {
-    // Should never happen.
-    return svtype();
-  }
-}
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+      std::uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
 
-template <typename T>
-auto string_view::make(T&& s) {
-  using type = std::remove_cv_t<std::remove_reference_t<T>>;
+      // The high bit of each zero byte, exactly (no borrow between bytes).
+      const std::uint64_t zero_bytes = ~(((word & low_bits) + low_bits) | word | low_bits);
 
-  constexpr bool is_any_string_or_string_view = std::is_same_v<type, std::string> //
-      || std::is_same_v<type, std::u16string> //
-      || std::is_same_v<type, std::u32string> //
-      || std::is_same_v<type, std::wstring> //
-      || std::is_same_v<type, std::string_view> //
-      || std::is_same_v<type, std::u16string_view> //
-      || std::is_same_v<type, std::u32string_view> //
-      || std::is_same_v<type, std::wstring_view>;
+      for (std::size_t j = 0; j < zeros.size(); j++) {
+        // Sums the 0 or 1 bytes in the top byte.
+        zeros[j] += static_cast<std::size_t>((((zero_bytes & columns[j]) >> 7) * 0x0101010101010101ull) >> 56);
+      }
+    }
 
-  static_assert(is_any_string_or_string_view || is_string_type<T>::value, "");
+    for (; i < size; i++) {
+      zeros[i % 4] += data[i] == 0;
+    }
 
-  if constexpr (is_any_string_or_string_view) {
-    return string_view(std::forward<T>(s), normal_tag{});
+    return zeros;
   }
 
-  else if constexpr (std::is_constructible_v<std::string_view, T>) {
-    return string_view(std::string_view(s), null_terminated_tag{});
-  }
+  /// Returns true when every 4 bytes unit of data is a valid utf32 code point.
+  inline bool is_utf32(const char* data, std::size_t size, bool big_endian) noexcept {
+    for (std::size_t i = 0; i + 4 <= size; i += 4) {
+      std::uint32_t cp = 0;
+      for (std::size_t k = 0; k < 4; k++) {
+        cp |= static_cast<std::uint32_t>(cast_8(data[i + k])) << (8 * (big_endian ? 3 - k : k));
+      }
 
-  else if constexpr (std::is_constructible_v<std::u16string_view, T>) {
-    return string_view(std::u16string_view(s), null_terminated_tag{});
-  }
+      if (cp > k_code_point_max || (cp >= k_lead_surrogate_min && cp < 0xE000u)) {
+        return false;
+      }
+    }
 
-  else if constexpr (std::is_constructible_v<std::u32string_view, T>) {
-    return string_view(std::u32string_view(s), null_terminated_tag{});
+    return true;
   }
 
-  else if constexpr (std::is_constructible_v<std::wstring_view, T>) {
-    return string_view(std::wstring_view(s), null_terminated_tag{});
+  inline char16_t utf16_unit(const char* data, bool big_endian) noexcept {
+    const std::uint8_t high = cast_8(data[big_endian ? 0 : 1]);
+    const std::uint8_t low = cast_8(data[big_endian ? 1 : 0]);
+    return static_cast<char16_t>((high << 8) | low);
   }
 
-  else {
-    // Should never happen.
-    return string_view();
-  }
-}
+  /// Returns true when every surrogate of data is paired. When truncated, data is a prefix and may
+  /// end in the middle of a unit or of a surrogate pair.
+  inline bool is_utf16(const char* data, std::size_t size, bool big_endian, bool truncated) noexcept {
+    if (size % 2 && !truncated) {
+      return false;
+    }
 
-std::string to_utf8(string_view s) { return s.to_utf8(); }
+    const std::size_t unit_count = size / 2;
+    for (std::size_t i = 0; i < unit_count; i++) {
+      const char16_t unit = utf16_unit(data + 2 * i, big_endian);
 
-std::u16string to_utf16(string_view s) { return s.to_utf16(); }
+      if (is_low_surrogate(unit)) {
+        return false;
+      }
 
-std::u32string to_utf32(string_view s) { return s.to_utf32(); }
+      if (is_high_surrogate(unit)) {
+        if (++i == unit_count) {
+          return truncated;
+        }
 
-std::wstring to_wide(string_view s) { return s.to_wide(); }
+        if (!is_low_surrogate(utf16_unit(data + 2 * i, big_endian))) {
+          return false;
+        }
+      }
+    }
 
-std::string string_view::to_utf8() const {
-  if (empty()) {
-    return {};
+    return true;
   }
 
-  switch (encoding()) {
-  case encoding::utf8:
-    return std::string(data<char>(), size());
-
-  case encoding::utf16:
-    return convert_as<char>(view<char16_t>());
+  /// Counts the utf16 units of data in the blocks of the scripts written without zero bytes:
+  /// Greek to Arabic, CJK (with kana and punctuation), Hangul and the fullwidth forms.
+  inline std::size_t count_utf16_script_units(const char* data, std::size_t size, bool big_endian) noexcept {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i + 2 <= size; i += 2) {
+      const char16_t unit = utf16_unit(data + i, big_endian);
+      count += (unit >= 0x0370 && unit < 0x0800) || (unit >= 0x3000 && unit < 0xA000)
+          || (unit >= 0xAC00 && unit < 0xD7A4) || (unit >= 0xFF00 && unit < 0xFFF0);
+    }
 
-  case encoding::utf32:
-    return convert_as<char>(view<char32_t>());
+    return count;
   }
 
-  return {};
-}
+  /// Counts the pairs of ascii bytes of data, most of the units of 8 bit text seen as utf16.
+  inline std::size_t count_ascii_pairs(const char* data, std::size_t size) noexcept {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i + 2 <= size; i += 2) {
+      count += (cast_8(data[i]) | cast_8(data[i + 1])) < 0x80;
+    }
 
-std::u16string string_view::to_utf16() const {
-  if (empty()) {
-    return {};
+    return count;
   }
 
-  switch (encoding()) {
-  case encoding::utf8:
-    return convert_as<char16_t>(view<char>());
+  /// Sees bytes as code units of CharT when they are aligned and in native byte order.
+  template <typename CharT>
+  inline string_view make_payload(std::string_view bytes, bool big_endian) noexcept {
+    if constexpr (sizeof(CharT) == 1) {
+      return bytes;
+    }
+    else {
+      if (big_endian == is_little_endian() || reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(CharT)) {
+        return string_view();
+      }
 
-  case encoding::utf16:
+      return std::basic_string_view<CharT>(
+          reinterpret_cast<const CharT*>(bytes.data()), bytes.size() / sizeof(CharT));
+    }
+  }
 
-    return std::u16string(data<char16_t>(), size());
+  inline encoding_detection make_detection(
+      std::string_view bytes, enum encoding enc, bool big_endian, bool has_bom, float confidence) noexcept {
+    encoding_detection result;
+    result.encoding = enc;
+    result.big_endian = big_endian;
+    result.has_bom = has_bom;
+    result.confidence = confidence;
+    result.bytes = bytes;
+
+    switch (enc) {
+    case encoding::utf8:
+      result.payload = make_payload<char>(bytes, big_endian);
+      break;
+    case encoding::utf16:
+      result.payload = make_payload<char16_t>(bytes, big_endian);
+      break;
+    case encoding::utf32:
+      result.payload = make_payload<char32_t>(bytes, big_endian);
+      break;
+    }
 
-  case encoding::utf32:
-    return convert_as<char16_t>(view<char32_t>());
+    return result;
   }
+} // namespace detail.
 
-  return {};
-}
+encoding_detection detect_encoding(std::string_view bytes) noexcept {
+  const auto starts_with = [&](std::initializer_list<std::uint8_t> mark) {
+    const auto equal = [](std::uint8_t a, char b) { return a == detail::cast_8(b); };
+    return bytes.size() >= mark.size() && std::equal(mark.begin(), mark.end(), bytes.begin(), equal);
+  };
 
-std::u32string string_view::to_utf32() const {
-  if (empty()) {
-    return {};
+  // utf32 first, its little endian mark starts like the utf16 one.
+  if (starts_with({ 0xFF, 0xFE, 0x00, 0x00 })) {
+    return detail::make_detection(bytes.substr(4), encoding::utf32, false, true, 1);
+  }
+  else if (starts_with({ 0x00, 0x00, 0xFE, 0xFF })) {
+    return detail::make_detection(bytes.substr(4), encoding::utf32, true, true, 1);
+  }
+  else if (detail::starts_with_bom(bytes.begin(), bytes.end())) {
+    return detail::make_detection(bytes.substr(3), encoding::utf8, false, true, 1);
+  }
+  else if (starts_with({ 0xFF, 0xFE })) {
+    return detail::make_detection(bytes.substr(2), encoding::utf16, false, true, 1);
+  }
+  else if (starts_with({ 0xFE, 0xFF })) {
+    return detail::make_detection(bytes.substr(2), encoding::utf16, true, true, 1);
   }
 
-  switch (encoding()) {
-  case encoding::utf8:
-    return convert_as<char32_t>(view<char>());
+  if (bytes.empty()) {
+    return detail::make_detection(bytes, encoding::utf8, false, false, 0);
+  }
 
-  case encoding::utf16:
-    return convert_as<char32_t>(view<char16_t>());
+  const std::string_view prefix = bytes.substr(0, detail::k_detect_encoding_prefix_size);
+  const bool truncated = prefix.size() < bytes.size();
+  const std::array<std::size_t, 4> zeros = detail::count_zero_bytes(prefix.data(), prefix.size());
 
-  case encoding::utf32:
-    return std::u32string(data<char32_t>(), size());
+  // The highest byte of a utf32 unit is always zero, the next one mostly.
+  const std::size_t unit_count = prefix.size() % 4 ? 0 : prefix.size() / 4;
+  if (unit_count && zeros[3] == unit_count && zeros[2] * 2 >= unit_count
+      && detail::is_utf32(prefix.data(), prefix.size(), false)) {
+    return detail::make_detection(bytes, encoding::utf32, false, false, 0.9f);
+  }
+  else if (unit_count && zeros[0] == unit_count && zeros[1] * 2 >= unit_count
+      && detail::is_utf32(prefix.data(), prefix.size(), true)) {
+    return detail::make_detection(bytes, encoding::utf32, true, false, 0.9f);
   }
 
-  return {};
-}
-
-std::wstring string_view::to_wide() const {
-  if (empty()) {
-    return {};
+  // The high byte of the latin characters is zero: utf16 when at least a quarter of the units
+  // have one on the same side, the more there are the surer the guess.
+  const std::size_t utf16_unit_count = std::max<std::size_t>(prefix.size() / 2, 1);
+  const std::size_t even_zeros = zeros[0] + zeros[2];
+  const std::size_t odd_zeros = zeros[1] + zeros[3];
+  const bool big_endian = even_zeros > odd_zeros;
+  const std::size_t difference = big_endian ? even_zeros - odd_zeros : odd_zeros - even_zeros;
+
+  if (difference * 4 >= utf16_unit_count && detail::is_utf16(prefix.data(), prefix.size(), big_endian, truncated)) {
+    const float confidence = 0.9f * static_cast<float>(difference) / static_cast<float>(utf16_unit_count);
+    return detail::make_detection(bytes, encoding::utf16, big_endian, false, std::min(confidence, 0.9f));
   }
 
-  switch (encoding()) {
-  case encoding::utf8:
-    return convert_as<wchar_t>(view<char>());
+  // A sequence cut at the end of the prefix isn't an error.
+  const conversion_error error = validate(prefix);
+  const bool is_utf8 = !error
+      || (error.code == error_code::truncated
+          && detail::incomplete_tail_size<encoding::utf8>(prefix.data(), prefix.size())
+              == prefix.size() - error.position);
 
-  case encoding::utf16:
-    return convert_as<wchar_t>(view<char16_t>());
+  if (is_utf8) {
+    return detail::make_detection(bytes, encoding::utf8, false, false, 0.9f);
+  }
 
-  case encoding::utf32:
-    return convert_as<wchar_t>(view<char32_t>());
+  // Utf16 without zero bytes: most of the units are in the blocks of a script, in the byte order
+  // that has the more of them. 8 bit text is mostly made of ascii pairs, which can look like CJK.
+  if (detail::count_ascii_pairs(prefix.data(), prefix.size()) * 2 < utf16_unit_count) {
+    std::array<std::size_t, 2> script_units = {};
+    for (bool order : { false, true }) {
+      if (detail::is_utf16(prefix.data(), prefix.size(), order, truncated)) {
+        script_units[order] = detail::count_utf16_script_units(prefix.data(), prefix.size(), order);
+      }
+    }
+
+    const bool order = script_units[1] > script_units[0];
+    if (script_units[order] * 4 >= utf16_unit_count * 3) {
+      return detail::make_detection(bytes, encoding::utf16, order, false, 0.5f);
+    }
   }
 
-  return {};
+  return detail::make_detection(bytes, encoding::utf8, false, false, 0.1f);
 }
 
-std::size_t string_view::count() const {
-  switch (encoding()) {
-  case encoding::utf8:
-    return unicode::length(view<char>());
+split_range string_view::split(char32_t delimiter) const noexcept {
+  return split_range(*this, split_range::mode::code_point, delimiter, string_view());
+}
 
-  case encoding::utf16:
-    return unicode::length(view<char16_t>());
+split_range string_view::lines() const noexcept {
+  return split_range(*this, split_range::mode::lines, 0, string_view());
+}
 
-  case encoding::utf32:
-    return size();
-  }
-  return 0;
+split_range string_view::split_any(const string_view& delimiters) const noexcept {
+  return split_range(*this, split_range::mode::any, 0, delimiters);
+}
+
+int string_view::compare(const string_view& other) const noexcept {
+  const bool known_valid = this->known_valid() && other.known_valid();
+
+  return unicode::visit(
+      [known_valid](auto a, auto b) {
+        if constexpr (std::is_same_v<decltype(a), decltype(b)>) {
+          return detail::compare_same_encoding(a, b, known_valid);
+        }
+        else {
+          return detail::compare_code_points(a, b);
+        }
+      },
+      *this, other);
 }
 
 inline const char* string_view::u8cstr() const noexcept { return c_str<char>(); }
@@ -1878,4 +5098,370 @@ inline std::basic_string_view<char32_t> string_view::u32view() const noexcept {
 
 /// Same as view<wchar_t>().
 inline std::wstring_view string_view::wview() const noexcept { return view<wchar_t>(); }
+
+//
+// Compile time literals.
+//
+
+namespace detail {
+  /// Returns true if the literal str is valid utf8, checked by a static_assert in the literals.
+  inline constexpr bool is_valid_utf8_literal(std::string_view str) noexcept {
+    const char* it = str.data();
+    const char* end = str.data() + str.size();
+
+    while (it != end) {
+      std::uint32_t cp = 0;
+      if (decode_u8(it, end, cp) != error_code::none) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// Returns the number of CharT code units needed for the utf8 literal str.
+  template <typename CharT>
+  inline constexpr std::size_t literal_length(std::string_view str) noexcept {
+    const char* it = str.data();
+    const char* end = str.data() + str.size();
+    std::size_t length = 0;
+
+    while (it != end) {
+      std::uint32_t cp = 0;
+      if (decode_u8(it, end, cp) != error_code::none) {
+        // Rejected by the static_assert, only avoids a second error.
+        cp = k_replacement_character;
+      }
+
+      length += (encoding_of<CharT>::value == encoding::utf16 && cp > 0xFFFF) ? 2 : 1;
+    }
+
+    return length;
+  }
+
+  /// Converts the utf8 literal str to a null terminated array of Size CharT code units.
+  template <typename CharT, std::size_t Size>
+  inline constexpr std::array<CharT, Size + 1> make_literal(std::string_view str) noexcept {
+    std::array<CharT, Size + 1> output{};
+    CharT* out = output.data();
+    const char* it = str.data();
+    const char* end = str.data() + str.size();
+
+    while (it != end) {
+      std::uint32_t cp = 0;
+      if (decode_u8(it, end, cp) != error_code::none) {
+        // Rejected by the static_assert, only avoids a second error.
+        cp = k_replacement_character;
+      }
+
+      out = append_code_point<encoding_of<CharT>::value>(cp, out);
+    }
+
+    return output;
+  }
+
+#ifdef NANO_UNICODE_CPP_20
+  template <std::size_t N>
+  struct fixed_u8_string {
+    constexpr fixed_u8_string(const char (&str)[N]) noexcept { std::copy_n(str, N, data); }
+
+    constexpr fixed_u8_string(const char8_t (&str)[N]) noexcept {
+      std::transform(str, str + N, data, [](char8_t c) { return static_cast<char>(c); });
+    }
+
+    constexpr std::string_view view() const noexcept { return std::string_view(data, N - 1); }
+
+    char data[N] = {};
+  };
+
+  template <typename CharT, fixed_u8_string Str>
+  struct literal_storage {
+    static_assert(is_valid_utf8_literal(Str.view()), "nano::unicode literal is not valid UTF-8");
+
+    static constexpr auto value = make_literal<CharT, literal_length<CharT>(Str.view())>(Str.view());
+
+    static constexpr std::basic_string_view<CharT> view() noexcept { return { value.data(), value.size() - 1 }; }
+  };
+#endif // NANO_UNICODE_CPP_20
+} // namespace detail.
+
+#ifdef NANO_UNICODE_CPP_20
+namespace detail {
+  /// Contiguous sized range of code units, the input of the transcoding views.
+  template <class R>
+  concept transcodable_range = std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+      && is_char_type<std::ranges::range_value_t<R>>::value;
+} // namespace detail.
+
+///
+/// View of the code units of V converted to CharT, see views::transcode.
+///
+/// Ill-formed sequences are converted to U+FFFD. The iterators only point into the
+/// underlying code units: the view is borrowed when V is borrowed.
+///
+/// Generic algorithms such as std::ranges::copy step the view one code point at a time,
+/// nano::unicode::copy(view, out) is the bulk conversion of input_view().
+///
+template <std::ranges::view V, typename CharT>
+  requires detail::transcodable_range<const V> && is_char_type<CharT>::value
+class transcode_view : public std::ranges::view_interface<transcode_view<V, CharT>> {
+  using input_char_type = std::ranges::range_value_t<const V>;
+
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = CharT;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = CharT;
+
+    iterator() noexcept = default;
+
+    inline CharT operator*() const noexcept { return m_units[m_index]; }
+
+    inline iterator& operator++() noexcept {
+      if (++m_index == m_size) {
+        m_pos = m_next;
+        decode();
+      }
+
+      return *this;
+    }
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    /// Returns the position in the input of the code point of the current code unit.
+    inline const input_char_type* base() const noexcept { return m_pos; }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept {
+      return a.m_pos == b.m_pos && a.m_index == b.m_index;
+    }
+
+  private:
+    friend class transcode_view;
+
+    inline iterator(const input_char_type* pos, const input_char_type* end) noexcept
+        : m_pos(pos)
+        , m_next(pos)
+        , m_end(end) {
+      decode();
+    }
+
+    inline void decode() noexcept {
+      m_index = 0;
+      m_size = 0;
+
+      if (m_next != m_end) {
+        CharT* out = detail::append_code_point<encoding_of<CharT>::value>(
+            detail::decode_or_replace(m_next, m_end), m_units.data());
+        m_size = static_cast<std::uint8_t>(out - m_units.data());
+      }
+    }
+
+    const input_char_type* m_pos = nullptr;
+    const input_char_type* m_next = nullptr;
+    const input_char_type* m_end = nullptr;
+    std::array<CharT, encoding_to_max_char_count<encoding_of<CharT>::value>::value> m_units = {};
+    std::uint8_t m_index = 0;
+    std::uint8_t m_size = 0;
+  };
+
+  transcode_view()
+    requires std::default_initializable<V>
+  = default;
+
+  inline constexpr explicit transcode_view(V base)
+      : m_base(std::move(base)) {}
+
+  inline constexpr V base() const&
+    requires std::copy_constructible<V>
+  {
+    return m_base;
+  }
+
+  inline constexpr V base() && { return std::move(m_base); }
+
+  /// Returns the code units of the underlying view.
+  inline std::basic_string_view<input_char_type> input_view() const noexcept {
+    return { std::ranges::data(m_base), static_cast<std::size_t>(std::ranges::size(m_base)) };
+  }
+
+  inline iterator begin() const noexcept {
+    std::basic_string_view<input_char_type> str = input_view();
+    return iterator(str.data(), str.data() + str.size());
+  }
+
+  inline iterator end() const noexcept {
+    std::basic_string_view<input_char_type> str = input_view();
+    return iterator(str.data() + str.size(), str.data() + str.size());
+  }
+
+private:
+  V m_base = V();
+};
+
+///
+/// View of the code points of V, see views::code_points.
+///
+/// Ill-formed sequences are seen as U+FFFD. The view is borrowed when V is borrowed.
+///
+template <std::ranges::view V>
+  requires detail::transcodable_range<const V>
+class code_points_view : public std::ranges::view_interface<code_points_view<V>> {
+  using input_char_type = std::ranges::range_value_t<const V>;
+
+public:
+  using iterator = typename basic_code_point_range<input_char_type>::iterator;
+
+  code_points_view()
+    requires std::default_initializable<V>
+  = default;
+
+  inline constexpr explicit code_points_view(V base)
+      : m_base(std::move(base)) {}
+
+  inline constexpr V base() const&
+    requires std::copy_constructible<V>
+  {
+    return m_base;
+  }
+
+  inline constexpr V base() && { return std::move(m_base); }
+
+  /// Returns the code units of the underlying view.
+  inline std::basic_string_view<input_char_type> input_view() const noexcept {
+    return { std::ranges::data(m_base), static_cast<std::size_t>(std::ranges::size(m_base)) };
+  }
+
+  inline iterator begin() const noexcept { return basic_code_point_range<input_char_type>(input_view()).begin(); }
+  inline iterator end() const noexcept { return basic_code_point_range<input_char_type>(input_view()).end(); }
+
+private:
+  V m_base = V();
+};
+
+template <class R>
+code_points_view(R&&) -> code_points_view<std::views::all_t<R>>;
+
+/// Bulk converts v to outputIt.
+/// Same output as std::ranges::copy(v, outputIt), without stepping the view one code unit at a time.
+/// This overload has to be called explicitly: std::ranges::copy and other generic code never reach it
+/// and always take the per-element path.
+template <class V, typename CharT, class OutputIt>
+inline OutputIt copy(const transcode_view<V, CharT>& v, OutputIt outputIt) {
+  static_assert(encoding_of<detail::output_iterator_value_type_t<OutputIt>>::value == encoding_of<CharT>::value,
+      "The output iterator should write code units of the view encoding.");
+  return copy_lossy(v.input_view(), outputIt);
+}
+
+namespace detail {
+  template <typename CharT>
+  struct transcode_adaptor {
+    template <std::ranges::viewable_range R>
+      requires transcodable_range<const std::views::all_t<R>>
+    inline constexpr auto operator()(R&& r) const {
+      return transcode_view<std::views::all_t<R>, CharT>(std::views::all(std::forward<R>(r)));
+    }
+
+    template <std::ranges::viewable_range R>
+      requires transcodable_range<const std::views::all_t<R>>
+    inline friend constexpr auto operator|(R&& r, const transcode_adaptor& adaptor) {
+      return adaptor(std::forward<R>(r));
+    }
+  };
+
+  struct code_points_adaptor {
+    template <std::ranges::viewable_range R>
+      requires transcodable_range<const std::views::all_t<R>>
+    inline constexpr auto operator()(R&& r) const {
+      return code_points_view<std::views::all_t<R>>(std::views::all(std::forward<R>(r)));
+    }
+
+    template <std::ranges::viewable_range R>
+      requires transcodable_range<const std::views::all_t<R>>
+    inline friend constexpr auto operator|(R&& r, const code_points_adaptor& adaptor) {
+      return adaptor(std::forward<R>(r));
+    }
+  };
+} // namespace detail.
+
+///
+/// Range adaptors composable with the std::views adaptors.
+///
+/// @code
+///   std::u16string_view text = ...;
+///   for (char32_t c : text | nano::unicode::views::code_points | std::views::take(10)) {
+///     ...
+///   }
+///
+///   std::u16string out(nano::unicode::convert_size<char16_t>(str), 0);
+///   nano::unicode::copy(str | nano::unicode::views::transcode<char16_t>, out.data());
+/// @endcode
+///
+namespace views {
+  template <typename CharT>
+  inline constexpr detail::transcode_adaptor<CharT> transcode{};
+
+  inline constexpr detail::code_points_adaptor code_points{};
+} // namespace views.
+
+///
+/// utf8 string literals converted at compile time to static null terminated storage.
+/// An ill-formed literal is a compile time error.
+///
+/// @code
+///   using namespace nano::unicode::literals;
+///   std::u16string_view title = "Café"_u16;
+/// @endcode
+///
+/// With C++17, use the NANO_UNICODE_U16, NANO_UNICODE_U32 and NANO_UNICODE_WIDE macros instead.
+///
+inline namespace literals {
+  template <detail::fixed_u8_string Str>
+  constexpr std::u16string_view operator""_u16() noexcept {
+    return detail::literal_storage<char16_t, Str>::view();
+  }
+
+  template <detail::fixed_u8_string Str>
+  constexpr std::u32string_view operator""_u32() noexcept {
+    return detail::literal_storage<char32_t, Str>::view();
+  }
+
+  template <detail::fixed_u8_string Str>
+  constexpr std::wstring_view operator""_wide() noexcept {
+    return detail::literal_storage<wchar_t, Str>::view();
+  }
+} // namespace literals.
+#endif // NANO_UNICODE_CPP_20
 } // namespace nano::unicode
+
+#ifdef NANO_UNICODE_CPP_20
+template <class V, typename CharT>
+inline constexpr bool std::ranges::enable_borrowed_range<nano::unicode::transcode_view<V, CharT>>
+    = std::ranges::enable_borrowed_range<V>;
+
+template <class V>
+inline constexpr bool std::ranges::enable_borrowed_range<nano::unicode::code_points_view<V>>
+    = std::ranges::enable_borrowed_range<V>;
+#endif // NANO_UNICODE_CPP_20
+
+/// Converts a utf8 string literal at compile time to a std::basic_string_view<CharT> of static storage.
+/// Same as the C++20 _u16, _u32 and _wide literals.
+#define NANO_UNICODE_LITERAL(CharT, str)                                                            \
+  ([]() noexcept -> std::basic_string_view<CharT> {                                                \
+    constexpr std::string_view nano_unicode_str = str;                                              \
+    static_assert(nano::unicode::detail::is_valid_utf8_literal(nano_unicode_str),                   \
+        "NANO_UNICODE_LITERAL: the literal is not valid UTF-8");                                    \
+    static constexpr auto nano_unicode_value = nano::unicode::detail::make_literal<CharT,          \
+        nano::unicode::detail::literal_length<CharT>(nano_unicode_str)>(nano_unicode_str);         \
+    return std::basic_string_view<CharT>(nano_unicode_value.data(), nano_unicode_value.size() - 1); \
+  }())
+
+#define NANO_UNICODE_U16(str) NANO_UNICODE_LITERAL(char16_t, str)
+#define NANO_UNICODE_U32(str) NANO_UNICODE_LITERAL(char32_t, str)
+#define NANO_UNICODE_WIDE(str) NANO_UNICODE_LITERAL(wchar_t, str)
@@ -0,0 +1,275 @@
+///
+/// BSD 3-Clause License
+///
+/// Copyright (c) 2022, Alexandre Arsenault
+/// All rights reserved.
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions are met:
+///
+/// * Redistributions of source code must retain the above copyright notice, this
+///   list of conditions and the following disclaimer.
+///
+/// * Redistributions in binary form must reproduce the above copyright notice,
+///   this list of conditions and the following disclaimer in the documentation
+///   and/or other materials provided with the distribution.
+///
+/// * Neither the name of the copyright holder nor the names of its
+///   contributors may be used to endorse or promote products derived from
+///   this software without specific prior written permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+/// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+/// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+/// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+/// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+/// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+/// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+/// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+/// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+/// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+///
+
+#pragma once
+
+#include "nano/unicode.h"
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#ifndef NANO_UNICODE_USE_MMAP
+  #if defined(__unix__) || defined(__APPLE__)
+    #define NANO_UNICODE_USE_MMAP 1
+  #else
+    #define NANO_UNICODE_USE_MMAP 0
+  #endif
+#endif
+
+#if NANO_UNICODE_USE_MMAP
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace nano::unicode {
+
+///
+/// Converts the file at in_path from one encoding to another into out_path.
+///
+/// Both files hold code units in native byte order. Ill-formed input is replaced with U+FFFD
+/// as in convert_as_lossy(), and replacements, if not null, receives the number of substitutions.
+///
+/// The input is memory mapped and converted straight into the memory mapped output, which is
+/// sized up front, so neither file is loaded in a string. Platforms without mmap() convert
+/// the file through blocks of a std::filebuf instead.
+///
+/// out_path can't be in_path or a link to it, the output is truncated before the input is read:
+/// std::errc::invalid_argument is returned and neither file is touched.
+///
+inline std::error_code transcode_file(const std::filesystem::path& in_path, const std::filesystem::path& out_path,
+    encoding from, encoding to, std::size_t* replacements = nullptr);
+
+//
+//**********************************************************************************************
+// Implementation.
+//**********************************************************************************************
+//
+
+namespace detail {
+  template <encoding Encoding>
+  inline constexpr std::size_t code_point_size(std::uint32_t cp) noexcept {
+    if constexpr (Encoding == encoding::utf8) {
+      return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+    }
+    else if constexpr (Encoding == encoding::utf16) {
+      return cp < 0x10000 ? 1 : 2;
+    }
+    else {
+      return 1;
+    }
+  }
+
+  /// Returns the size of the lossy conversion of str to To.
+  template <typename To, typename From>
+  inline std::size_t convert_size_lossy(std::basic_string_view<From> str) {
+    if (!unicode::validate(str)) {
+      return unicode::convert_size<To>(str);
+    }
+
+    std::size_t size = 0;
+    for (const From* it = str.data(); it != str.data() + str.size();) {
+      size += code_point_size<encoding_of<To>::value>(decode_or_replace(it, str.data() + str.size()));
+    }
+
+    return size;
+  }
+
+  /// Converts a file through fixed size blocks, used when the files can't be mapped.
+  template <typename From, typename To>
+  inline std::error_code transcode_file_stream(
+      const std::filesystem::path& in_path, const std::filesystem::path& out_path, std::size_t& replacements) {
+    std::ifstream input(in_path, std::ios::binary);
+    if (!input) {
+      return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    std::ofstream output(out_path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+      return std::make_error_code(std::errc::permission_denied);
+    }
+
+    transcoding_streambuf<To, From> reader(input.rdbuf());
+    std::array<To, 4096> block;
+
+    for (std::streamsize size; (size = reader.sgetn(block.data(), static_cast<std::streamsize>(block.size()))) > 0;) {
+      output.write(reinterpret_cast<const char*>(block.data()), size * static_cast<std::streamsize>(sizeof(To)));
+    }
+
+    replacements = reader.replacements();
+    return output.flush() ? std::error_code() : std::make_error_code(std::errc::io_error);
+  }
+
+#if NANO_UNICODE_USE_MMAP
+  inline std::error_code last_system_error() noexcept { return std::error_code(errno, std::generic_category()); }
+
+  /// Unmaps and closes on scope exit.
+  struct file_mapping {
+    int fd = -1;
+    void* data = nullptr;
+    std::size_t size = 0;
+
+    inline ~file_mapping() {
+      if (data) {
+        ::munmap(data, size);
+      }
+
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+
+    inline bool map(int prot) noexcept {
+      data = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) {
+        data = nullptr;
+        return false;
+      }
+
+      ::madvise(data, size, MADV_SEQUENTIAL);
+      return true;
+    }
+  };
+
+  template <typename From, typename To>
+  inline std::error_code transcode_file_mmap(
+      const std::filesystem::path& in_path, const std::filesystem::path& out_path, std::size_t& replacements) {
+    file_mapping input;
+    input.fd = ::open(in_path.c_str(), O_RDONLY);
+
+    struct stat info;
+    if (input.fd == -1 || ::fstat(input.fd, &info) == -1) {
+      return last_system_error();
+    }
+
+    if (!S_ISREG(info.st_mode)) {
+      // Pipes and devices can't be mapped.
+      return transcode_file_stream<From, To>(in_path, out_path, replacements);
+    }
+
+    input.size = static_cast<std::size_t>(info.st_size);
+    if (input.size && !input.map(PROT_READ)) {
+      return last_system_error();
+    }
+
+    // A partial code unit at the end is replaced like a truncated sequence.
+    const std::size_t partial_size = input.size % sizeof(From);
+    const std::basic_string_view<From> str(static_cast<const From*>(input.data), input.size / sizeof(From));
+    const std::size_t output_size = convert_size_lossy<To>(str)
+        + (partial_size ? code_point_size<encoding_of<To>::value>(k_replacement_character) : 0);
+
+    file_mapping output;
+    output.fd = ::open(out_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    output.size = output_size * sizeof(To);
+
+    if (output.fd == -1 || ::ftruncate(output.fd, static_cast<off_t>(output.size)) == -1) {
+      return last_system_error();
+    }
+
+    if (output.size == 0) {
+      return {};
+    }
+
+    if (!output.map(PROT_READ | PROT_WRITE)) {
+      return last_system_error();
+    }
+
+    To* last = unicode::copy_lossy(str, static_cast<To*>(output.data), &replacements);
+
+    if (partial_size) {
+      append_code_point<encoding_of<To>::value>(k_replacement_character, last);
+      replacements++;
+    }
+
+    return {};
+  }
+#endif // NANO_UNICODE_USE_MMAP
+
+  template <typename From, typename To>
+  inline std::error_code transcode_file(
+      const std::filesystem::path& in_path, const std::filesystem::path& out_path, std::size_t& replacements) {
+#if NANO_UNICODE_USE_MMAP
+    return transcode_file_mmap<From, To>(in_path, out_path, replacements);
+#else
+    return transcode_file_stream<From, To>(in_path, out_path, replacements);
+#endif // NANO_UNICODE_USE_MMAP
+  }
+
+  template <typename From>
+  inline std::error_code transcode_file(const std::filesystem::path& in_path, const std::filesystem::path& out_path,
+      encoding to, std::size_t& replacements) {
+    switch (to) {
+    case encoding::utf8:
+      return transcode_file<From, char>(in_path, out_path, replacements);
+    case encoding::utf16:
+      return transcode_file<From, char16_t>(in_path, out_path, replacements);
+    case encoding::utf32:
+      return transcode_file<From, char32_t>(in_path, out_path, replacements);
+    }
+
+    return std::make_error_code(std::errc::invalid_argument);
+  }
+} // namespace detail.
+
+inline std::error_code transcode_file(const std::filesystem::path& in_path, const std::filesystem::path& out_path,
+    encoding from, encoding to, std::size_t* replacements) {
+  std::size_t count = 0;
+  std::error_code error = std::make_error_code(std::errc::invalid_argument);
+
+  // Fails (and returns false) when out_path doesn't exist yet.
+  std::error_code equivalent_error;
+  if (std::filesystem::equivalent(in_path, out_path, equivalent_error)) {
+    return error;
+  }
+
+  switch (from) {
+  case encoding::utf8:
+    error = detail::transcode_file<char>(in_path, out_path, to, count);
+    break;
+  case encoding::utf16:
+    error = detail::transcode_file<char16_t>(in_path, out_path, to, count);
+    break;
+  case encoding::utf32:
+    error = detail::transcode_file<char32_t>(in_path, out_path, to, count);
+    break;
+  }
+
+  if (replacements) {
+    *replacements = count;
+  }
+
+  return error;
+}
+} // namespace nano::unicode
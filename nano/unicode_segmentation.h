@@ -0,0 +1,954 @@
+///
+/// BSD 3-Clause License
+///
+/// Copyright (c) 2022, Alexandre Arsenault
+/// All rights reserved.
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions are met:
+///
+/// * Redistributions of source code must retain the above copyright notice, this
+///   list of conditions and the following disclaimer.
+///
+/// * Redistributions in binary form must reproduce the above copyright notice,
+///   this list of conditions and the following disclaimer in the documentation
+///   and/or other materials provided with the distribution.
+///
+/// * Neither the name of the copyright holder nor the names of its
+///   contributors may be used to endorse or promote products derived from
+///   this software without specific prior written permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+/// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+/// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+/// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+/// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+/// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+/// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+/// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+/// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+/// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+///
+
+#pragma once
+
+#include "nano/unicode.h"
+#include "nano/unicode_tables.h"
+
+namespace nano::unicode {
+
+///
+/// Range of the extended grapheme clusters (UAX #29) of a string_view, see graphemes().
+///
+/// Each cluster is a sub view of the input, ill-formed sequences are seen as U+FFFD.
+///
+class grapheme_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const string_view*;
+    using reference = string_view;
+
+    iterator() noexcept = default;
+
+    inline string_view operator*() const noexcept;
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    /// Returns the code unit offset of the current cluster.
+    inline std::size_t offset() const noexcept { return m_pos; }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.m_pos == b.m_pos; }
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return a.m_pos != b.m_pos; }
+
+  private:
+    friend class grapheme_range;
+
+    inline iterator(string_view str, std::size_t pos) noexcept;
+
+    string_view m_str;
+    std::size_t m_pos = 0;
+    std::size_t m_next = 0;
+  };
+
+  inline explicit grapheme_range(string_view str) noexcept
+      : m_str(str) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str, 0); }
+  inline iterator end() const noexcept { return iterator(m_str, m_str.size()); }
+
+private:
+  string_view m_str;
+};
+
+/// Returns the range of the extended grapheme clusters of s.
+/// @code
+///   for (nano::unicode::string_view cluster : nano::unicode::graphemes(text)) {
+///     draw(cluster);
+///   }
+/// @endcode
+inline grapheme_range graphemes(const string_view& s) noexcept;
+
+/// Returns the offset of the grapheme cluster boundary that follows pos, which must be a boundary.
+inline std::size_t next_grapheme_boundary(const string_view& s, std::size_t pos) noexcept;
+
+/// Returns the longest prefix of s made of whole grapheme clusters that has at most max_units code units.
+inline string_view truncate_to_graphemes(const string_view& s, std::size_t max_units) noexcept;
+
+///
+/// Piece of text between two word boundaries (UAX #29), see words().
+///
+struct word_segment {
+  string_view text;
+
+  /// Code unit offset of text in the input.
+  std::size_t offset = 0;
+
+  /// True when text contains a letter or a number, false for spaces, punctuation or symbols.
+  bool is_word = false;
+};
+
+///
+/// Range of the word boundary segments (UAX #29) of a string_view, see words().
+///
+/// Each segment is a sub view of the input, ill-formed sequences are seen as U+FFFD.
+/// Nothing is allocated.
+///
+class word_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = word_segment;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const word_segment*;
+    using reference = const word_segment&;
+
+    iterator() noexcept = default;
+
+    inline const word_segment& operator*() const noexcept { return m_segment; }
+    inline const word_segment* operator->() const noexcept { return &m_segment; }
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept {
+      return a.m_segment.offset == b.m_segment.offset;
+    }
+
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return !(a == b); }
+
+  private:
+    friend class word_range;
+
+    inline iterator(string_view str, std::size_t pos) noexcept;
+
+    string_view m_str;
+    word_segment m_segment;
+  };
+
+  inline explicit word_range(string_view str) noexcept
+      : m_str(str) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str, 0); }
+  inline iterator end() const noexcept { return iterator(m_str, m_str.size()); }
+
+private:
+  string_view m_str;
+};
+
+/// Returns the range of the word boundary segments of s.
+/// @code
+///   for (const nano::unicode::word_segment& w : nano::unicode::words(text)) {
+///     if (w.is_word) {
+///       index(w.text, w.offset);
+///     }
+///   }
+/// @endcode
+inline word_range words(const string_view& s) noexcept;
+
+/// Returns the offset of the word boundary that follows pos, which must be a boundary.
+/// If is_word is not null, it receives the classification of the segment [pos, boundary).
+inline std::size_t next_word_boundary(const string_view& s, std::size_t pos, bool* is_word = nullptr) noexcept;
+
+///
+/// Piece of text between two line break opportunities (UAX #14), see line_breaks().
+///
+struct line_break_segment {
+  /// Text up to the break opportunity, with its trailing spaces and mandatory break characters.
+  string_view text;
+
+  /// Code unit offset of text in the input.
+  std::size_t offset = 0;
+
+  /// True when the line must break after text (BK, CR, LF, NL or the end of the input),
+  /// false when it may break there.
+  bool is_mandatory = false;
+};
+
+///
+/// Range of the line break opportunities (UAX #14) of a string_view, see line_breaks().
+///
+/// Each segment is a sub view of the input, ill-formed sequences are seen as U+FFFD.
+/// Nothing is allocated.
+///
+class line_break_range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = line_break_segment;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const line_break_segment*;
+    using reference = const line_break_segment&;
+
+    iterator() noexcept = default;
+
+    inline const line_break_segment& operator*() const noexcept { return m_segment; }
+    inline const line_break_segment* operator->() const noexcept { return &m_segment; }
+
+    inline iterator& operator++() noexcept;
+
+    inline iterator operator++(int) noexcept {
+      iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    inline friend bool operator==(const iterator& a, const iterator& b) noexcept {
+      return a.m_segment.offset == b.m_segment.offset;
+    }
+
+    inline friend bool operator!=(const iterator& a, const iterator& b) noexcept { return !(a == b); }
+
+  private:
+    friend class line_break_range;
+
+    inline iterator(string_view str, std::size_t pos) noexcept;
+
+    string_view m_str;
+    line_break_segment m_segment;
+  };
+
+  inline explicit line_break_range(string_view str) noexcept
+      : m_str(str) {}
+
+  inline iterator begin() const noexcept { return iterator(m_str, 0); }
+  inline iterator end() const noexcept { return iterator(m_str, m_str.size()); }
+
+private:
+  string_view m_str;
+};
+
+/// Returns the range of the line break opportunities of s.
+/// @code
+///   for (const nano::unicode::line_break_segment& piece : nano::unicode::line_breaks(paragraph)) {
+///     if (!fits(line, piece.text)) {
+///       new_line();
+///     }
+///
+///     append(line, piece.text);
+///
+///     if (piece.is_mandatory) {
+///       new_line();
+///     }
+///   }
+/// @endcode
+inline line_break_range line_breaks(const string_view& s) noexcept;
+
+/// Returns the offset of the line break opportunity that follows pos, which must be a break opportunity.
+/// If is_mandatory is not null, it receives whether the line must break there.
+inline std::size_t next_line_break(const string_view& s, std::size_t pos, bool* is_mandatory = nullptr) noexcept;
+
+//
+// Implementation.
+//
+
+namespace detail {
+  template <typename CharT>
+  inline constexpr std::uint32_t code_unit_value(CharT c) noexcept {
+    return static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<CharT>>(c));
+  }
+
+  /// What has been seen of the current cluster, for the rules that look further back than one code point.
+  struct grapheme_state {
+    /// Number of consecutive regional indicators before the boundary (GB12, GB13).
+    std::size_t regional_indicators = 0;
+
+    /// 1 after ExtPict Extend*, 2 after ExtPict Extend* ZWJ (GB11).
+    std::uint8_t emoji = 0;
+  };
+
+  inline bool is_grapheme_break(grapheme_break prev, std::uint8_t next_bits, const grapheme_state& state) noexcept {
+    using gb = grapheme_break;
+    const gb next = static_cast<gb>(next_bits & k_grapheme_break_mask);
+
+    // GB3, GB4, GB5.
+    if (prev == gb::cr && next == gb::lf) {
+      return false;
+    }
+
+    if (prev == gb::control || prev == gb::cr || prev == gb::lf || next == gb::control || next == gb::cr
+        || next == gb::lf) {
+      return true;
+    }
+
+    // GB6, GB7, GB8: Hangul syllables.
+    if (prev == gb::l && (next == gb::l || next == gb::v || next == gb::lv || next == gb::lvt)) {
+      return false;
+    }
+
+    if ((prev == gb::lv || prev == gb::v) && (next == gb::v || next == gb::t)) {
+      return false;
+    }
+
+    if ((prev == gb::lvt || prev == gb::t) && next == gb::t) {
+      return false;
+    }
+
+    // GB9, GB9a, GB9b.
+    if (next == gb::extend || next == gb::zwj || next == gb::spacing_mark || prev == gb::prepend) {
+      return false;
+    }
+
+    // GB11: emoji zwj sequences.
+    if (prev == gb::zwj && state.emoji == 2 && (next_bits & k_grapheme_break_extended_pictographic_flag)) {
+      return false;
+    }
+
+    // GB12, GB13: regional indicators are paired.
+    if (prev == gb::regional_indicator && next == gb::regional_indicator) {
+      return state.regional_indicators % 2 == 0;
+    }
+
+    // GB999.
+    return true;
+  }
+
+  inline void update_grapheme_state(grapheme_state& state, std::uint8_t bits) noexcept {
+    const grapheme_break value = static_cast<grapheme_break>(bits & k_grapheme_break_mask);
+
+    state.regional_indicators = value == grapheme_break::regional_indicator ? state.regional_indicators + 1 : 0;
+
+    if (bits & k_grapheme_break_extended_pictographic_flag) {
+      state.emoji = 1;
+    }
+    else if (state.emoji == 1 && value == grapheme_break::zwj) {
+      state.emoji = 2;
+    }
+    else if (state.emoji != 1 || value != grapheme_break::extend) {
+      state.emoji = 0;
+    }
+  }
+
+  template <typename CharT>
+  inline std::size_t next_grapheme_boundary(std::basic_string_view<CharT> str, std::size_t pos) noexcept {
+    const CharT* first = str.data();
+    const CharT* end = first + str.size();
+    const CharT* it = first + pos;
+
+    if (it == end) {
+      return str.size();
+    }
+
+    // Ascii fast path: an ascii code unit followed by another one is a whole cluster, except for CR LF.
+    const std::uint32_t c = code_unit_value(*it);
+    if (c < 0x80 && (it + 1 == end || code_unit_value(it[1]) < 0x80)) {
+      return pos + (c == '\r' && it + 1 != end && code_unit_value(it[1]) == '\n' ? 2 : 1);
+    }
+
+    std::uint8_t bits = grapheme_break_bits(decode_or_replace(it, end));
+    grapheme_state state;
+    update_grapheme_state(state, bits);
+
+    while (it != end) {
+      const CharT* next = it;
+      const std::uint8_t next_bits = grapheme_break_bits(decode_or_replace(next, end));
+
+      if (is_grapheme_break(static_cast<grapheme_break>(bits & k_grapheme_break_mask), next_bits, state)) {
+        break;
+      }
+
+      update_grapheme_state(state, next_bits);
+      bits = next_bits;
+      it = next;
+    }
+
+    return static_cast<std::size_t>(it - first);
+  }
+
+  inline constexpr bool is_ascii_alphanumeric(std::uint32_t c) noexcept {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+  }
+
+  /// Ascii code units that can join the letters or numbers around them (WB6, WB7, WB11, WB12).
+  inline constexpr bool is_ascii_word_middle(std::uint32_t c) noexcept {
+    return c == '.' || c == ':' || c == ',' || c == ';' || c == '\'';
+  }
+
+  inline constexpr bool is_word_ignored(word_break value) noexcept {
+    return value == word_break::extend || value == word_break::format || value == word_break::zwj;
+  }
+
+  inline constexpr bool is_ah_letter(word_break value) noexcept {
+    return value == word_break::aletter || value == word_break::hebrew_letter;
+  }
+
+  inline constexpr bool is_mid_letter(word_break value) noexcept {
+    return value == word_break::mid_letter || value == word_break::mid_num_let || value == word_break::single_quote;
+  }
+
+  inline constexpr bool is_mid_num(word_break value) noexcept {
+    return value == word_break::mid_num || value == word_break::mid_num_let || value == word_break::single_quote;
+  }
+
+  /// Returns the word break value of the first code point at or after it that WB4 doesn't ignore.
+  template <typename CharT>
+  inline word_break next_word_break_value(const CharT* it, const CharT* end) noexcept {
+    while (it != end) {
+      const word_break value = static_cast<word_break>(word_break_bits(decode_or_replace(it, end)) & k_word_break_mask);
+
+      if (!is_word_ignored(value)) {
+        return value;
+      }
+    }
+
+    return word_break::other;
+  }
+
+  /// The WB5 to WB999 rules, once WB4 removed the ignored code points.
+  /// prev_prev is the value before prev in the segment, or other at its start.
+  template <typename CharT>
+  inline bool is_word_break(word_break prev_prev, word_break prev, word_break next, std::size_t regional_indicators,
+      const CharT* after, const CharT* end) noexcept {
+    using wb = word_break;
+
+    // WB5, WB6, WB7.
+    if (is_ah_letter(prev) && is_ah_letter(next)) {
+      return false;
+    }
+
+    if (is_ah_letter(prev) && is_mid_letter(next) && is_ah_letter(next_word_break_value(after, end))) {
+      return false;
+    }
+
+    if (is_ah_letter(prev_prev) && is_mid_letter(prev) && is_ah_letter(next)) {
+      return false;
+    }
+
+    // WB7a, WB7b, WB7c.
+    if (prev == wb::hebrew_letter && next == wb::single_quote) {
+      return false;
+    }
+
+    if (prev == wb::hebrew_letter && next == wb::double_quote
+        && next_word_break_value(after, end) == wb::hebrew_letter) {
+      return false;
+    }
+
+    if (prev_prev == wb::hebrew_letter && prev == wb::double_quote && next == wb::hebrew_letter) {
+      return false;
+    }
+
+    // WB8, WB9, WB10, WB11, WB12.
+    if ((prev == wb::numeric || is_ah_letter(prev)) && (next == wb::numeric || is_ah_letter(next))) {
+      return false;
+    }
+
+    if (prev_prev == wb::numeric && is_mid_num(prev) && next == wb::numeric) {
+      return false;
+    }
+
+    if (prev == wb::numeric && is_mid_num(next) && next_word_break_value(after, end) == wb::numeric) {
+      return false;
+    }
+
+    // WB13, WB13a, WB13b.
+    if (prev == wb::katakana && next == wb::katakana) {
+      return false;
+    }
+
+    const bool prev_joins = is_ah_letter(prev) || prev == wb::numeric || prev == wb::katakana;
+    const bool next_joins = is_ah_letter(next) || next == wb::numeric || next == wb::katakana;
+
+    if ((prev_joins || prev == wb::extend_num_let) && next == wb::extend_num_let) {
+      return false;
+    }
+
+    if (prev == wb::extend_num_let && next_joins) {
+      return false;
+    }
+
+    // WB15, WB16: regional indicators are paired.
+    if (prev == wb::regional_indicator && next == wb::regional_indicator) {
+      return regional_indicators % 2 == 0;
+    }
+
+    // WB999.
+    return true;
+  }
+
+  template <typename CharT>
+  inline std::size_t next_word_boundary(std::basic_string_view<CharT> str, std::size_t pos, bool& is_word) noexcept {
+    using wb = word_break;
+    const CharT* first = str.data();
+    const CharT* end = first + str.size();
+    const CharT* it = first + pos;
+    is_word = false;
+
+    if (it == end) {
+      return str.size();
+    }
+
+    // Ascii fast path: a run of ascii letters, digits and underscores is a word when it is followed by
+    // the end or an ascii code unit that can't join it.
+    if (is_ascii_alphanumeric(code_unit_value(*it))) {
+      const CharT* run_end = it;
+      bool has_alphanumeric = false;
+
+      for (; run_end != end && is_ascii_alphanumeric(code_unit_value(*run_end)); ++run_end) {
+        has_alphanumeric = has_alphanumeric || code_unit_value(*run_end) != '_';
+      }
+
+      if (run_end == end || (code_unit_value(*run_end) < 0x80 && !is_ascii_word_middle(code_unit_value(*run_end)))) {
+        is_word = has_alphanumeric;
+        return static_cast<std::size_t>(run_end - first);
+      }
+    }
+
+    std::uint8_t bits = word_break_bits(decode_or_replace(it, end));
+    is_word = (bits & k_word_break_word_character_flag) != 0;
+
+    // raw_prev is the last code point, prev the last one that WB4 doesn't ignore.
+    wb raw_prev = static_cast<wb>(bits & k_word_break_mask);
+    wb prev = raw_prev;
+    wb prev_prev = wb::other;
+    std::size_t regional_indicators = prev == wb::regional_indicator ? 1 : 0;
+
+    while (it != end) {
+      const CharT* after = it;
+      const char32_t cp = decode_or_replace(after, end);
+      bits = word_break_bits(cp);
+      const wb next = static_cast<wb>(bits & k_word_break_mask);
+      const bool is_line_break = next == wb::newline || next == wb::cr || next == wb::lf;
+
+      // WB3, WB3a, WB3b.
+      if (raw_prev == wb::cr && next == wb::lf) {
+        it = after;
+        raw_prev = next;
+        continue;
+      }
+
+      if (raw_prev == wb::newline || raw_prev == wb::cr || raw_prev == wb::lf || is_line_break) {
+        break;
+      }
+
+      // WB3c, WB3d, WB4.
+      const bool is_pictographic = grapheme_break_bits(cp) & k_grapheme_break_extended_pictographic_flag;
+      const bool joins
+          = (raw_prev == wb::zwj && is_pictographic) || (raw_prev == wb::wseg_space && next == wb::wseg_space);
+
+      if (is_word_ignored(next)) {
+        is_word = is_word || (bits & k_word_break_word_character_flag) != 0;
+        raw_prev = next;
+        it = after;
+        continue;
+      }
+
+      if (!joins && is_word_break(prev_prev, prev, next, regional_indicators, after, end)) {
+        break;
+      }
+
+      is_word = is_word || (bits & k_word_break_word_character_flag) != 0;
+      regional_indicators = next == wb::regional_indicator ? regional_indicators + 1 : 0;
+      prev_prev = prev;
+      prev = next;
+      raw_prev = next;
+      it = after;
+    }
+
+    return static_cast<std::size_t>(it - first);
+  }
+
+  /// Entries of the UAX #14 pair table.
+  enum class line_break_action : std::uint8_t {
+    /// A break is allowed between the two classes.
+    direct,
+
+    /// A break is allowed only when spaces separate the two classes.
+    indirect,
+
+    /// No break, even with spaces in between.
+    prohibited
+  };
+
+  template <typename... Values>
+  inline constexpr bool is_any_of(line_break value, Values... values) noexcept {
+    return ((value == values) || ...);
+  }
+
+  /// Returns true if no break is allowed before value, even after spaces (LB11, LB13).
+  inline constexpr bool is_line_break_prohibited_before(line_break value) noexcept {
+    return is_any_of(value, line_break::wj, line_break::cl, line_break::cp, line_break::ex, line_break::is,
+        line_break::sy);
+  }
+
+  /// The pair rules LB11 to LB30b, in order. Classes that LB4 to LB10 handle (BK, CR, LF, NL, SP, ZW)
+  /// never reach the table, CM and ZWJ are looked up as AL (LB10).
+  /// The conditions of LB21a, LB30, LB30a and LB30b that need more than the two classes are checked
+  /// by next_line_break().
+  inline constexpr line_break_action line_break_pair_rule(line_break before, line_break after) noexcept {
+    using lb = line_break;
+    using action = line_break_action;
+    constexpr auto is_ah = [](lb value) { return value == lb::al || value == lb::hl; };
+
+    // The prohibitions that hold whatever is before the spaces come before the WJ and GL rows.
+    if (is_line_break_prohibited_before(after) || before == lb::op) {
+      return action::prohibited; // LB11, LB13, LB14.
+    }
+
+    if (before == lb::wj || before == lb::gl) {
+      return action::indirect; // LB11, LB12.
+    }
+
+    if (after == lb::gl && before != lb::ba && before != lb::hy) {
+      return action::indirect; // LB12a.
+    }
+
+    if ((before == lb::qu && after == lb::op) || (is_any_of(before, lb::cl, lb::cp) && after == lb::ns)
+        || (before == lb::b2 && after == lb::b2)) {
+      return action::prohibited; // LB15, LB16, LB17.
+    }
+
+    if (before == lb::qu || after == lb::qu) {
+      return action::indirect; // LB19.
+    }
+
+    if (before == lb::cb || after == lb::cb) {
+      return action::direct; // LB20.
+    }
+
+    if (is_any_of(after, lb::ba, lb::hy, lb::ns) || before == lb::bb || (before == lb::sy && after == lb::hl)
+        || after == lb::in) {
+      return action::indirect; // LB21, LB21b, LB22.
+    }
+
+    if ((is_ah(before) && after == lb::nu) || (before == lb::nu && is_ah(after))
+        || (before == lb::pr && is_any_of(after, lb::id, lb::eb, lb::em))
+        || (is_any_of(before, lb::id, lb::eb, lb::em) && after == lb::po)
+        || (is_any_of(before, lb::pr, lb::po) && is_ah(after)) || (is_ah(before) && is_any_of(after, lb::pr, lb::po))) {
+      return action::indirect; // LB23, LB23a, LB24.
+    }
+
+    if ((is_any_of(before, lb::cl, lb::cp, lb::nu) && is_any_of(after, lb::po, lb::pr))
+        || (is_any_of(before, lb::po, lb::pr) && is_any_of(after, lb::op, lb::nu))
+        || (is_any_of(before, lb::hy, lb::is, lb::nu, lb::sy) && after == lb::nu)) {
+      return action::indirect; // LB25.
+    }
+
+    if ((before == lb::jl && is_any_of(after, lb::jl, lb::jv, lb::h2, lb::h3))
+        || (is_any_of(before, lb::jv, lb::h2) && is_any_of(after, lb::jv, lb::jt))
+        || (is_any_of(before, lb::jt, lb::h3) && after == lb::jt)
+        || (is_any_of(before, lb::jl, lb::jv, lb::jt, lb::h2, lb::h3) && after == lb::po)
+        || (before == lb::pr && is_any_of(after, lb::jl, lb::jv, lb::jt, lb::h2, lb::h3))) {
+      return action::indirect; // LB26, LB27.
+    }
+
+    if ((is_ah(before) && is_ah(after)) || (before == lb::is && is_ah(after))) {
+      return action::indirect; // LB28, LB29.
+    }
+
+    if ((is_any_of(before, lb::al, lb::hl, lb::nu) && after == lb::op)
+        || (before == lb::cp && is_any_of(after, lb::al, lb::hl, lb::nu))) {
+      return action::indirect; // LB30, unless the OP or CP is East Asian wide.
+    }
+
+    if ((before == lb::ri && after == lb::ri) || (before == lb::eb && after == lb::em)) {
+      return action::indirect; // LB30a (for an odd number of RI), LB30b.
+    }
+
+    return action::direct; // LB31.
+  }
+
+  inline constexpr auto k_line_break_pairs = []() {
+    std::array<std::array<line_break_action, k_line_break_count>, k_line_break_count> pairs = {};
+
+    for (std::size_t i = 0; i < k_line_break_count; i++) {
+      for (std::size_t j = 0; j < k_line_break_count; j++) {
+        pairs[i][j] = line_break_pair_rule(static_cast<line_break>(i), static_cast<line_break>(j));
+      }
+    }
+
+    return pairs;
+  }();
+
+  inline constexpr bool is_ascii_letter_or_digit(std::uint32_t c) noexcept {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+  }
+
+  template <typename CharT>
+  inline std::size_t next_line_break(std::basic_string_view<CharT> str, std::size_t pos, bool& is_mandatory) noexcept {
+    using lb = line_break;
+    using action = line_break_action;
+    const CharT* first = str.data();
+    const CharT* end = first + str.size();
+    const CharT* it = first + pos;
+    is_mandatory = true;
+
+    if (it == end) {
+      return str.size();
+    }
+
+    // prev is the class before the spaces, with the CM and ZWJ of LB9 attached to it.
+    // raw_prev is the class of the last code point.
+    std::uint8_t bits = line_break_bits(decode_or_replace(it, end));
+    lb raw_prev = static_cast<lb>(bits & k_line_break_mask);
+    lb prev = is_any_of(raw_prev, lb::cm, lb::zwj) ? lb::al : raw_prev;
+    lb prev_prev = lb::al;
+    std::uint8_t prev_bits = bits;
+    std::size_t regional_indicators = prev == lb::ri ? 1 : 0;
+    bool spaces = false;
+
+    // Spaces at the start of the text or after a mandatory break have no class before them (LB2, LB6),
+    // only the class after them can prohibit a break.
+    bool leading_spaces = false;
+
+    // LB4, LB5.
+    if (is_any_of(raw_prev, lb::bk, lb::lf, lb::nl)) {
+      return static_cast<std::size_t>(it - first);
+    }
+
+    if (raw_prev == lb::cr) {
+      return static_cast<std::size_t>(it - first) + (it != end && code_unit_value(*it) == '\n' ? 1 : 0);
+    }
+
+    if (raw_prev == lb::sp) {
+      spaces = true;
+      leading_spaces = true;
+    }
+
+    while (it != end) {
+      // Ascii fast path: ascii letters and digits never break after a letter or a number (LB23, LB25, LB28).
+      if (!spaces && raw_prev != lb::zwj && is_any_of(prev, lb::al, lb::hl, lb::nu)
+          && is_ascii_letter_or_digit(code_unit_value(*it))) {
+        const CharT* run = it;
+        while (run != end && is_ascii_letter_or_digit(code_unit_value(*run))) {
+          ++run;
+        }
+
+        prev_prev = run - it > 1 ? lb::al : prev;
+        prev = code_unit_value(run[-1]) <= '9' ? lb::nu : lb::al;
+        raw_prev = prev;
+        prev_bits = 0;
+        regional_indicators = 0;
+        it = run;
+        continue;
+      }
+
+      const CharT* after = it;
+      bits = line_break_bits(decode_or_replace(after, end));
+      const lb value = static_cast<lb>(bits & k_line_break_mask);
+
+      // LB4, LB5, LB6: no break before a mandatory break, which ends the segment.
+      if (is_any_of(value, lb::bk, lb::lf, lb::nl)) {
+        return static_cast<std::size_t>(after - first);
+      }
+
+      if (value == lb::cr) {
+        return static_cast<std::size_t>(after - first) + (after != end && code_unit_value(*after) == '\n' ? 1 : 0);
+      }
+
+      // LB7.
+      if (value == lb::sp) {
+        spaces = true;
+        raw_prev = value;
+        it = after;
+        continue;
+      }
+
+      if (value == lb::zw) {
+        prev = value;
+        raw_prev = value;
+        spaces = false;
+        leading_spaces = false;
+        it = after;
+        continue;
+      }
+
+      // LB8.
+      if (prev == lb::zw) {
+        break;
+      }
+
+      // LB9: CM and ZWJ attach to what is before them, unless it is a space.
+      const bool is_combining = is_any_of(value, lb::cm, lb::zwj);
+      if (is_combining && !spaces) {
+        raw_prev = value;
+        it = after;
+        continue;
+      }
+
+      // LB10.
+      const lb next = is_combining ? lb::al : value;
+      bool is_break = true;
+
+      if (leading_spaces) {
+        is_break = !is_line_break_prohibited_before(next);
+      }
+      else if (raw_prev == lb::zwj) {
+        is_break = false; // LB8a.
+      }
+      else if (!spaces && prev_prev == lb::hl && is_any_of(prev, lb::hy, lb::ba)) {
+        is_break = false; // LB21a.
+      }
+      else if (!spaces && next == lb::em && (prev_bits & k_line_break_unassigned_pictographic_flag)) {
+        is_break = false; // LB30b.
+      }
+      else {
+        switch (k_line_break_pairs[static_cast<std::size_t>(prev)][static_cast<std::size_t>(next)]) {
+        case action::direct:
+          is_break = true;
+          break;
+
+        case action::indirect:
+          if (spaces) {
+            is_break = true;
+          }
+          else if (is_any_of(prev, lb::al, lb::hl, lb::nu) && next == lb::op) {
+            is_break = (bits & k_line_break_east_asian_wide_flag) != 0; // LB30.
+          }
+          else if (prev == lb::cp && is_any_of(next, lb::al, lb::hl, lb::nu)) {
+            is_break = (prev_bits & k_line_break_east_asian_wide_flag) != 0; // LB30.
+          }
+          else if (prev == lb::ri && next == lb::ri) {
+            is_break = regional_indicators % 2 == 0; // LB30a.
+          }
+          else {
+            is_break = false;
+          }
+          break;
+
+        case action::prohibited:
+          is_break = false;
+          break;
+        }
+      }
+
+      if (is_break) {
+        break;
+      }
+
+      regional_indicators = next == lb::ri ? regional_indicators + 1 : 0;
+      prev_prev = prev;
+      prev = next;
+      prev_bits = bits;
+      raw_prev = value;
+      spaces = false;
+      leading_spaces = false;
+      it = after;
+    }
+
+    is_mandatory = it == end;
+    return static_cast<std::size_t>(it - first);
+  }
+} // namespace detail.
+
+grapheme_range::iterator::iterator(string_view str, std::size_t pos) noexcept
+    : m_str(str)
+    , m_pos(pos)
+    , m_next(next_grapheme_boundary(str, pos)) {}
+
+string_view grapheme_range::iterator::operator*() const noexcept { return detail::sub_view(m_str, m_pos, m_next); }
+
+grapheme_range::iterator& grapheme_range::iterator::operator++() noexcept {
+  m_pos = m_next;
+  m_next = next_grapheme_boundary(m_str, m_pos);
+  return *this;
+}
+
+grapheme_range graphemes(const string_view& s) noexcept { return grapheme_range(s); }
+
+std::size_t next_grapheme_boundary(const string_view& s, std::size_t pos) noexcept {
+  return s.visit([&](auto str) { return detail::next_grapheme_boundary(str, pos); });
+}
+
+string_view truncate_to_graphemes(const string_view& s, std::size_t max_units) noexcept {
+  if (s.size() <= max_units) {
+    return s;
+  }
+
+  std::size_t size = 0;
+  for (std::size_t next = next_grapheme_boundary(s, 0); next <= max_units; next = next_grapheme_boundary(s, next)) {
+    size = next;
+  }
+
+  return detail::sub_view(s, 0, size);
+}
+
+word_range::iterator::iterator(string_view str, std::size_t pos) noexcept
+    : m_str(str) {
+  m_segment.offset = pos;
+  m_segment.text = detail::sub_view(m_str, pos, next_word_boundary(m_str, pos, &m_segment.is_word));
+}
+
+word_range::iterator& word_range::iterator::operator++() noexcept {
+  const std::size_t pos = m_segment.offset + m_segment.text.size();
+  m_segment.offset = pos;
+  m_segment.text = detail::sub_view(m_str, pos, next_word_boundary(m_str, pos, &m_segment.is_word));
+  return *this;
+}
+
+word_range words(const string_view& s) noexcept { return word_range(s); }
+
+std::size_t next_word_boundary(const string_view& s, std::size_t pos, bool* is_word) noexcept {
+  bool word = false;
+  const std::size_t boundary = s.visit([&](auto str) { return detail::next_word_boundary(str, pos, word); });
+
+  if (is_word) {
+    *is_word = word;
+  }
+
+  return boundary;
+}
+
+line_break_range::iterator::iterator(string_view str, std::size_t pos) noexcept
+    : m_str(str) {
+  m_segment.offset = pos;
+  m_segment.text = detail::sub_view(m_str, pos, next_line_break(m_str, pos, &m_segment.is_mandatory));
+}
+
+line_break_range::iterator& line_break_range::iterator::operator++() noexcept {
+  const std::size_t pos = m_segment.offset + m_segment.text.size();
+  m_segment.offset = pos;
+  m_segment.text = detail::sub_view(m_str, pos, next_line_break(m_str, pos, &m_segment.is_mandatory));
+  return *this;
+}
+
+line_break_range line_breaks(const string_view& s) noexcept { return line_break_range(s); }
+
+std::size_t next_line_break(const string_view& s, std::size_t pos, bool* is_mandatory) noexcept {
+  bool mandatory = false;
+  const std::size_t boundary = s.visit([&](auto str) { return detail::next_line_break(str, pos, mandatory); });
+
+  if (is_mandatory) {
+    *is_mandatory = mandatory;
+  }
+
+  return boundary;
+}
+} // namespace nano::unicode
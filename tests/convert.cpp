@@ -1,5 +1,7 @@
 #include "nano/test.h"
 #include "nano/unicode.h"
+#include <sstream>
+#include <vector>
 
 namespace {
 namespace utf = nano::unicode;
@@ -524,6 +526,517 @@ TEST_CASE("nano-unicode", unicode_u8_iterator) {
   //
 }
 
+TEST_CASE("nano-unicode", unicode_convert_strict) {
+  {
+    std::string in = getTestString();
+    auto s16 = utf::convert_as_strict<char16_t>(in);
+    auto s32 = utf::convert_as_strict<char32_t>(in);
+    auto sw = utf::convert_as_strict<wchar_t>(in);
+    EXPECT_TRUE(s16.ok());
+    EXPECT_TRUE(s32.ok());
+    EXPECT_TRUE(sw.ok());
+    EXPECT_TRUE(s16.value == getTestUTF16String());
+    EXPECT_TRUE(s32.value == getTestUTF32String());
+    EXPECT_TRUE(sw.value == getTestWString());
+
+    auto s8 = utf::convert_as_strict<char>(std::u16string(getTestUTF16String()));
+    EXPECT_TRUE(s8.ok());
+    EXPECT_TRUE(s8.value == getTestString());
+    EXPECT_TRUE(utf::convert_as_strict<char>(std::u32string(getTestUTF32String())).value == getTestString());
+    EXPECT_TRUE(utf::convert_as_strict<char16_t>(std::u32string(getTestUTF32String())).value == getTestUTF16String());
+    EXPECT_TRUE(utf::convert_as_strict<char32_t>(std::u16string(getTestUTF16String())).value == getTestUTF32String());
+  }
+
+  {
+    auto check = [](std::string_view in, utf::error_code code, std::size_t position) {
+      utf::conversion_result<char16_t> r16 = utf::convert_as_strict<char16_t>(in);
+      utf::conversion_result<char32_t> r32 = utf::convert_as_strict<char32_t>(in);
+      utf::conversion_error err = utf::validate(in);
+      return r16.error.code == code && r16.error.position == position && r32.error.code == code
+          && r32.error.position == position && err.code == code && err.position == position
+          && r32.value.size() == utf::length(code == utf::error_code::none ? in : in.substr(0, position));
+    };
+
+    EXPECT_TRUE(check("abc\xC3\xA9", utf::error_code::none, 0));
+    EXPECT_TRUE(check("abcdefghijklmnop\xC3", utf::error_code::truncated, 16));
+    EXPECT_TRUE(check("ab\xE2\x82", utf::error_code::truncated, 2));
+    EXPECT_TRUE(check("ab\xE2\x82z", utf::error_code::truncated, 2));
+    EXPECT_TRUE(check("\xC0\x80", utf::error_code::overlong, 0));
+    EXPECT_TRUE(check("a\xE0\x80\x80", utf::error_code::overlong, 1));
+    EXPECT_TRUE(check("\xC3\xA9\xF0\x80\x80\x80", utf::error_code::overlong, 2));
+    EXPECT_TRUE(check("a\xED\xA0\x80", utf::error_code::surrogate, 1));
+    EXPECT_TRUE(check("\xF4\x90\x80\x80", utf::error_code::out_of_range, 0));
+    EXPECT_TRUE(check("\xF5\x80\x80\x80", utf::error_code::out_of_range, 0));
+    EXPECT_TRUE(check("a\x80", utf::error_code::invalid_lead, 1));
+    EXPECT_TRUE(check("\xFF", utf::error_code::invalid_lead, 0));
+  }
+
+  {
+    std::u16string in = u"ab";
+    in.push_back(static_cast<char16_t>(0xDC00));
+    auto r = utf::convert_as_strict<char>(in);
+    EXPECT_TRUE(r.error.code == utf::error_code::surrogate);
+    EXPECT_EQ(r.error.position, 2u);
+    EXPECT_TRUE(r.value == "ab");
+
+    in = u"abc";
+    in.push_back(static_cast<char16_t>(0xD800));
+    EXPECT_TRUE(utf::convert_as_strict<char32_t>(in).error.code == utf::error_code::truncated);
+    in.push_back(u'a');
+    EXPECT_TRUE(utf::convert_as_strict<char32_t>(in).error.code == utf::error_code::surrogate);
+    EXPECT_TRUE(utf::convert_as_strict<char16_t>(in).error.code == utf::error_code::surrogate);
+    EXPECT_EQ(utf::convert_as_strict<char16_t>(in).value.size(), 3u);
+  }
+
+  {
+    std::u32string in = U"abc";
+    in.push_back(0x110000);
+    auto r = utf::convert_as_strict<char>(in);
+    EXPECT_TRUE(r.error.code == utf::error_code::out_of_range);
+    EXPECT_EQ(r.error.position, 3u);
+
+    in[3] = 0xDFFF;
+    EXPECT_TRUE(utf::convert_as_strict<char16_t>(in).error.code == utf::error_code::surrogate);
+  }
+}
+
+TEST_CASE("nano-unicode", unicode_convert_lossy) {
+  {
+    std::string in = getTestString();
+    std::size_t replacements = 1;
+    EXPECT_TRUE(utf::convert_as_lossy<char16_t>(in, &replacements) == getTestUTF16String());
+    EXPECT_EQ(replacements, 0u);
+    EXPECT_TRUE(utf::convert_as_lossy<char>(in) == getTestString());
+    EXPECT_TRUE(utf::convert_as_lossy<char>(std::u32string(getTestUTF32String())) == getTestString());
+  }
+
+  {
+    // Unicode 14, Table 3-8: maximal subparts.
+    std::string_view in = "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64";
+    std::size_t replacements = 0;
+    EXPECT_TRUE(utf::convert_as_lossy<char32_t>(in, &replacements) == U"a���b�c��d");
+    EXPECT_EQ(replacements, 6u);
+
+    EXPECT_TRUE(utf::convert_as_lossy<char>(in, &replacements) == "a���b�c��d");
+    EXPECT_EQ(replacements, 6u);
+
+    std::u16string out;
+    utf::copy_lossy(std::string_view("\xC0\x80\xED\xA0\x80\xF4\x90\x80\x80z"), std::back_inserter(out), &replacements);
+    EXPECT_TRUE(out == u"���������z");
+    EXPECT_EQ(replacements, 9u);
+
+    EXPECT_TRUE(utf::convert_as_lossy<char16_t>(std::string_view("ab\xE2\x82")) == u"ab�");
+  }
+
+  {
+    std::u16string in = u"a";
+    in.push_back(static_cast<char16_t>(0xDC00));
+    in.push_back(static_cast<char16_t>(0xD800));
+    in.push_back(u'b');
+    in.push_back(static_cast<char16_t>(0xD800));
+
+    std::size_t replacements = 0;
+    EXPECT_TRUE(utf::convert_as_lossy<char>(in, &replacements) == "a��b�");
+    EXPECT_EQ(replacements, 3u);
+    EXPECT_TRUE(utf::convert_as_lossy<char16_t>(in) == u"a��b�");
+
+    std::u32string in32 = U"a";
+    in32.push_back(0x110000);
+    in32.push_back(0xD800);
+    EXPECT_TRUE(utf::convert_as_lossy<char16_t>(in32, &replacements) == u"a��");
+    EXPECT_EQ(replacements, 2u);
+  }
+}
+
+TEST_CASE("nano-unicode", unicode_error_policies) {
+  std::string_view bad = "ab\xC3\x28";
+
+  {
+    std::u16string a = utf::convert_as<char16_t>(bad);
+    std::u16string b = utf::convert_as<char16_t, utf::assume_valid>(bad);
+    EXPECT_TRUE(a == b);
+
+    std::size_t replacements = 0;
+    std::u16string r = utf::convert_as<char16_t, utf::replace>(bad, &replacements);
+    EXPECT_TRUE(r == u"ab�(");
+    EXPECT_EQ(replacements, 1u);
+
+    utf::conversion_result<char16_t> s = utf::convert_as<char16_t, utf::strict>(bad);
+    EXPECT_FALSE(s.ok());
+    EXPECT_TRUE(s.error.code == utf::error_code::truncated);
+    EXPECT_EQ(s.error.position, 2u);
+    EXPECT_TRUE(s.value == u"ab");
+  }
+
+  {
+    std::u32string r;
+    std::size_t replacements = 0;
+    utf::copy<utf::replace>(bad, std::back_inserter(r), &replacements);
+    EXPECT_TRUE(r == U"ab�(");
+    EXPECT_EQ(replacements, 1u);
+
+    std::u32string s;
+    utf::copy_result<std::back_insert_iterator<std::u32string>> result
+        = utf::copy<utf::strict>(bad, std::back_inserter(s));
+    EXPECT_TRUE(result.error.code == utf::error_code::truncated);
+    EXPECT_TRUE(s == U"ab");
+
+    std::u32string v;
+    EXPECT_TRUE(utf::copy<utf::strict>(std::string_view("ab"), std::back_inserter(v)).ok());
+  }
+
+  {
+    std::u16string r;
+    utf::u8_to_u16<utf::replace>(bad.begin(), bad.end(), std::back_inserter(r));
+    EXPECT_TRUE(r == u"ab�(");
+
+    std::string s;
+    std::u32string in = U"ab";
+    in.push_back(0x110000);
+    auto result = utf::u32_to_u8<utf::strict>(in.begin(), in.end(), std::back_inserter(s));
+    EXPECT_TRUE(result.error.code == utf::error_code::out_of_range);
+    EXPECT_EQ(result.error.position, 2u);
+    EXPECT_TRUE(s == "ab");
+  }
+
+  {
+    std::string in(bad);
+    std::u32string r;
+    for (std::u32string_view c : utf::iterate_as<char32_t, utf::replace>(in)) {
+      r += c;
+    }
+    EXPECT_TRUE(r == U"ab�(");
+
+    std::string same;
+    for (std::string_view c : utf::iterate<utf::replace>(in)) {
+      same += c;
+    }
+    EXPECT_TRUE(same == "ab�(");
+
+    std::size_t empty_count = 0;
+    std::size_t count = 0;
+    for (std::u16string_view c : utf::iterate_as<char16_t, utf::strict>(in)) {
+      empty_count += c.empty() ? 1u : 0u;
+      count++;
+    }
+    EXPECT_EQ(count, 4u);
+    EXPECT_EQ(empty_count, 1u);
+
+    std::size_t it_count = 0;
+    using replace_iterator = utf::iterator<std::string::const_iterator, utf::replace>;
+    for (replace_iterator it(in.cbegin(), in.cend()); it.base() != in.cend(); ++it) {
+      it_count++;
+    }
+    EXPECT_EQ(it_count, 4u);
+  }
+}
+
+TEST_CASE("nano-unicode", unicode_truncated_tail) {
+  // Exact size heap buffers so that an over-read is caught by the sanitizers.
+  auto make_buffer = [](std::string_view s) {
+    std::unique_ptr<char[]> buffer(new char[s.size()]);
+    std::memcpy(buffer.get(), s.data(), s.size());
+    return buffer;
+  };
+
+  for (std::string_view in : { std::string_view("ab\xE2\x82"), std::string_view("\xF0"),
+           std::string_view("abcdefgh\xF0\x9F\x98"), std::string_view("\xC3") }) {
+    std::unique_ptr<char[]> buffer = make_buffer(in);
+    std::string_view view(buffer.get(), in.size());
+
+    std::u16string s16 = utf::convert_as<char16_t>(view);
+    std::u32string s32 = utf::convert_as<char32_t>(view);
+    EXPECT_EQ(s16.back(), u'\xFFFD');
+    EXPECT_EQ(s32.back(), U'\xFFFD');
+    EXPECT_EQ(utf::convert_size<char16_t>(view), s16.size());
+    EXPECT_EQ(utf::convert_size<char32_t>(view), s32.size());
+    EXPECT_EQ(utf::length(view), s32.size());
+  }
+
+  // An invalid byte within the last code units is a single code point.
+  for (std::string_view in : { std::string_view("abcdefgh\x80xy"), std::string_view("abcdefgh\xFFx") }) {
+    std::unique_ptr<char[]> buffer = make_buffer(in);
+    std::string_view view(buffer.get(), in.size());
+    EXPECT_EQ(utf::convert_size<char32_t>(view), utf::convert_as<char32_t>(view).size());
+    EXPECT_EQ(utf::convert_size<char16_t>(view), utf::convert_as<char16_t>(view).size());
+  }
+
+  {
+    std::u16string in = u"abc";
+    in.push_back(static_cast<char16_t>(0xD83D));
+    std::unique_ptr<char16_t[]> buffer(new char16_t[in.size()]);
+    std::copy(in.begin(), in.end(), buffer.get());
+    std::u16string_view view(buffer.get(), in.size());
+
+    EXPECT_TRUE(utf::convert_as<char>(view) == "abc�");
+    EXPECT_TRUE(utf::convert_as<char32_t>(view) == U"abc�");
+    EXPECT_EQ(utf::convert_size<char>(view), 6u);
+    EXPECT_EQ(utf::convert_size<char32_t>(view), 4u);
+  }
+
+  {
+    // Stray continuation bytes don't stall the length computation.
+    EXPECT_EQ(utf::length(std::string_view("\x80\x80" "a")), 3u);
+  }
+}
+
+TEST_CASE("nano-unicode", unicode_literals) {
+  EXPECT_TRUE(NANO_UNICODE_U16("Café 𝄞") == u"Café 𝄞");
+  EXPECT_TRUE(NANO_UNICODE_U32("Café 𝄞") == U"Café 𝄞");
+  EXPECT_TRUE(NANO_UNICODE_WIDE("Café 𝄞") == L"Café 𝄞");
+  EXPECT_TRUE(NANO_UNICODE_U16("").empty());
+  EXPECT_EQ(NANO_UNICODE_U16("ab").data()[2], u'\0');
+
+#ifdef NANO_UNICODE_CPP_20
+  using namespace utf::literals;
+  static_assert("Café 𝄞"_u16 == u"Café 𝄞");
+  static_assert("Café 𝄞"_u32 == U"Café 𝄞");
+  EXPECT_TRUE("Café 𝄞"_wide == L"Café 𝄞");
+  EXPECT_TRUE(u8"Café"_u16 == u"Café");
+  EXPECT_EQ("𝄞"_u16.size(), 2u);
+#endif
+}
+
+TEST_CASE("nano-unicode", unicode_bidirectional_iterators) {
+  {
+    std::string s = getTestString();
+    std::vector<std::u32string> forward;
+    for (std::u32string_view c : utf::iterate_as<char32_t>(s)) {
+      forward.emplace_back(c);
+    }
+
+    auto range = utf::iterate_as<char32_t>(s);
+    std::vector<std::u32string> backward;
+    for (auto it = range.end(); it != range.begin();) {
+      backward.emplace_back(*--it);
+    }
+
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_TRUE(forward == backward);
+
+    // The views point into s, std::reverse_iterator can be used.
+    auto u8range = utf::iterate(s);
+    std::string reversed;
+    for (auto it = std::make_reverse_iterator(u8range.end()); it != std::make_reverse_iterator(u8range.begin()); ++it) {
+      reversed.insert(0, *it);
+    }
+
+    EXPECT_TRUE(reversed == s);
+    EXPECT_TRUE(*std::prev(u8range.end()) == std::string_view(s).substr(s.size() - 1));
+  }
+
+  {
+    std::u16string s = u"a𝄞b";
+    auto it = utf::iterator(s.end());
+    EXPECT_TRUE(*--it == u"b");
+    EXPECT_TRUE(*--it == u"𝄞");
+    EXPECT_TRUE(*--it == u"a");
+    EXPECT_TRUE(it.base() == s.begin());
+  }
+
+  {
+    // Ill-formed input, backward steps land on the same elements as forward steps.
+    std::string s = "a\xF0\x80\x80\x80z\xE2\x82\xC3\xA9\x80\xED\xA0\x80";
+    auto range = utf::iterate_as<char32_t, utf::replace>(s);
+    std::vector<std::u32string> forward(range.begin(), range.end());
+    std::vector<std::u32string> backward;
+    for (auto it = range.end(); it != range.begin();) {
+      backward.emplace_back(*--it);
+    }
+
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_TRUE(forward == backward);
+    EXPECT_EQ(forward.size(), 12u);
+  }
+
+  {
+    std::u16string s = u"x\xDC00\xD800\xD800\xDC00y";
+    auto range = utf::iterate<utf::strict>(s);
+    std::size_t forward = static_cast<std::size_t>(std::distance(range.begin(), range.end()));
+    std::size_t backward = 0;
+    for (auto it = range.end(); it != range.begin(); --it) {
+      backward++;
+    }
+    EXPECT_EQ(forward, 5u);
+    EXPECT_EQ(backward, forward);
+  }
+
+  {
+    std::u32string s = U"abc𝄞e";
+    auto range = utf::iterate_as<char>(s);
+    using iterator_type = decltype(range.begin());
+    using category = std::iterator_traits<iterator_type>::iterator_category;
+    EXPECT_TRUE((std::is_same_v<category, std::random_access_iterator_tag>));
+    EXPECT_EQ(range.end() - range.begin(), 5);
+    EXPECT_TRUE(utf::iterate(s).begin()[3] == U"𝄞");
+    EXPECT_TRUE(*(range.end() - 2) == "𝄞");
+    EXPECT_TRUE(range.begin() < range.end());
+
+    auto it = utf::iterator(s.begin()) + 4;
+    EXPECT_TRUE(*it == U"e");
+    EXPECT_EQ(it - utf::iterator(s.begin()), 4);
+
+    using u8_iterator_type = decltype(utf::iterate(std::string()).begin());
+    using u8_category = std::iterator_traits<u8_iterator_type>::iterator_category;
+    EXPECT_TRUE((std::is_same_v<u8_category, std::bidirectional_iterator_tag>));
+  }
+}
+
+#ifdef NANO_UNICODE_CPP_20
+TEST_CASE("nano-unicode", unicode_ranges_views) {
+  static_assert(std::ranges::forward_range<decltype(std::u16string_view() | utf::views::transcode<char>)>);
+  static_assert(std::ranges::view<decltype(std::u16string_view() | utf::views::code_points)>);
+  static_assert(std::ranges::borrowed_range<decltype(std::u16string_view() | utf::views::transcode<char>)>);
+  static_assert(!std::ranges::borrowed_range<decltype(std::u16string() | utf::views::transcode<char>)>);
+
+  std::u16string_view u16 = u"a€𝄞b";
+  std::string u8;
+  std::ranges::copy(u16 | utf::views::transcode<char>, std::back_inserter(u8));
+  EXPECT_EQ(u8, "a€𝄞b");
+
+  std::u32string u32;
+  std::ranges::copy(utf::views::code_points(std::string_view("x\xFFy")), std::back_inserter(u32));
+  EXPECT_TRUE(u32 == U"x�y");
+
+  u32.clear();
+  auto upper = [](char32_t c) { return c >= 0x80; };
+  for (char32_t c : u16 | utf::views::code_points | std::views::filter(upper) | std::views::take(1)) {
+    u32.push_back(c);
+  }
+  EXPECT_TRUE(u32 == U"€");
+
+  std::string text = getTestString();
+  std::u16string bulk(utf::convert_size<char16_t>(text), 0);
+  char16_t* bulk_end = utf::copy(text | utf::views::transcode<char16_t>, bulk.data());
+  EXPECT_EQ(bulk_end, bulk.data() + bulk.size());
+
+  std::u16string stepped;
+  std::ranges::copy(text | utf::views::transcode<char16_t>, std::back_inserter(stepped));
+  EXPECT_TRUE(stepped == bulk);
+  EXPECT_TRUE(stepped == utf::convert_as<char16_t>(text));
+}
+#endif // NANO_UNICODE_CPP_20
+
+TEST_CASE("nano-unicode", unicode_transcoder) {
+  std::string text = getTestString();
+  std::u16string expected = utf::convert_as<char16_t>(text);
+
+  for (std::size_t chunk_size = 1; chunk_size <= 7; chunk_size++) {
+    utf::transcoder<char, char16_t> decoder;
+    std::u16string out;
+
+    for (std::size_t i = 0; i < text.size(); i += chunk_size) {
+      decoder.feed(std::string_view(text).substr(i, chunk_size), std::back_inserter(out));
+      EXPECT_TRUE(decoder.pending() < 4);
+    }
+
+    decoder.finish(std::back_inserter(out));
+    EXPECT_TRUE(out == expected);
+    EXPECT_EQ(decoder.replacements(), 0);
+  }
+
+  {
+    std::u16string_view u16 = u"a𝄞b";
+    utf::transcoder<char16_t, char> encoder;
+    std::string out;
+    encoder.feed(u16.substr(0, 2), std::back_inserter(out));
+    EXPECT_EQ(encoder.pending(), 1);
+    EXPECT_EQ(out, "a");
+    encoder.feed(u16.substr(2), std::back_inserter(out));
+    encoder.finish(std::back_inserter(out));
+    EXPECT_EQ(out, "a𝄞b");
+    EXPECT_EQ(encoder.pending(), 0);
+  }
+
+  {
+    utf::transcoder<char, char32_t> decoder;
+    std::u32string out;
+    decoder.feed(std::string_view("x\xE2"), std::back_inserter(out));
+    decoder.feed(std::string_view("\x82"), std::back_inserter(out));
+    EXPECT_EQ(decoder.pending(), 2);
+    decoder.feed(std::string_view("A\xF0\x9F"), std::back_inserter(out));
+    EXPECT_TRUE(out == U"x�A");
+    EXPECT_EQ(decoder.pending(), 2);
+    decoder.finish(std::back_inserter(out));
+    EXPECT_TRUE(out == U"x�A�");
+    EXPECT_EQ(decoder.replacements(), 2);
+
+    decoder.reset();
+    out.clear();
+    decoder.feed(std::string_view("\xFF\xC0\x80z\xE2\x82"), std::back_inserter(out));
+    decoder.feed(std::string_view("\xAC"), std::back_inserter(out));
+    EXPECT_TRUE(out == utf::convert_as_lossy<char32_t>(std::string_view("\xFF\xC0\x80z\xE2\x82\xAC")));
+  }
+
+  {
+    utf::transcoder<char, char> copier;
+    std::string out;
+    copier.feed(std::string_view("\xE2\x82"), std::back_inserter(out));
+    copier.feed(std::string_view("\xAC!"), std::back_inserter(out));
+    copier.finish(std::back_inserter(out));
+    EXPECT_EQ(out, "€!");
+
+    utf::transcoder<char32_t, char> encoder;
+    encoder.feed(std::u32string_view(U"\x20AC"), std::back_inserter(out));
+    EXPECT_EQ(encoder.pending(), 0);
+    EXPECT_EQ(out, "€!€");
+  }
+}
+
+TEST_CASE("nano-unicode", unicode_transcoding_streambuf) {
+  std::string text = getTestString();
+
+  {
+    std::stringbuf target;
+    {
+      utf::transcoding_streambuf<wchar_t, char> buffer(&target);
+      std::wostream wlog(&buffer);
+      wlog << getTestWString() << L'\n' << getTestWString();
+    }
+
+    EXPECT_EQ(target.str(), text + "\n" + text);
+  }
+
+  {
+    std::stringbuf target;
+    utf::transcoding_streambuf<char16_t, char> buffer(&target);
+    buffer.sputn(u"a\xD834", 2);
+    buffer.pubsync();
+    EXPECT_EQ(target.str(), "a");
+    buffer.sputn(u"\xDD1E\xDD1E", 2);
+    buffer.pubsync();
+    EXPECT_EQ(target.str(), "a𝄞�");
+    EXPECT_EQ(buffer.replacements(), 1);
+  }
+
+  {
+    std::u16string u16 = utf::convert_as<char16_t>(text);
+    std::stringbuf target(std::string(reinterpret_cast<const char*>(u16.data()), u16.size() * sizeof(char16_t)));
+    utf::transcoding_streambuf<char, char16_t> buffer(&target);
+    std::istream input(&buffer);
+
+    std::string line;
+    std::getline(input, line);
+    EXPECT_EQ(line, text.substr(0, text.find('\n')));
+
+    std::string rest((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(rest, text.substr(text.find('\n') + 1));
+    EXPECT_EQ(buffer.replacements(), 0);
+  }
+
+  {
+    std::u32string u32 = U"ab\xD800";
+    std::string bytes(reinterpret_cast<const char*>(u32.data()), u32.size() * sizeof(char32_t));
+    std::stringbuf target(bytes + "x");
+    utf::transcoding_streambuf<char16_t, char32_t> buffer(&target);
+
+    std::u16string out;
+    std::copy(std::istreambuf_iterator<char16_t>(&buffer), std::istreambuf_iterator<char16_t>(), std::back_inserter(out));
+    EXPECT_TRUE(out == u"ab��");
+    EXPECT_EQ(buffer.replacements(), 2);
+  }
+}
+
 inline constexpr const char* ss = R"(Original by Markus Kuhn, adapted for HTML by Martin Dürst.
 
 UTF-8 encoded sample plain-text file
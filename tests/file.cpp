@@ -0,0 +1,72 @@
+#include "nano/test.h"
+#include "nano/unicode_file.h"
+#include <fstream>
+#include <iterator>
+
+namespace {
+namespace utf = nano::unicode;
+
+template <typename CharT>
+void write_units(const std::filesystem::path& path, std::basic_string_view<CharT> units) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(units.data()), static_cast<std::streamsize>(units.size() * sizeof(CharT)));
+}
+
+template <typename CharT>
+std::basic_string<CharT> read_units(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::basic_string<CharT> units(bytes.size() / sizeof(CharT), 0);
+  std::memcpy(units.data(), bytes.data(), units.size() * sizeof(CharT));
+  return units;
+}
+
+TEST_CASE("nano-unicode-file", transcode_file) {
+  const std::filesystem::path in_path = std::filesystem::temp_directory_path() / "nano-unicode-file-in.txt";
+  const std::filesystem::path out_path = std::filesystem::temp_directory_path() / "nano-unicode-file-out.txt";
+
+  std::u16string text;
+  for (int i = 0; i < 2000; i++) {
+    text += u"Grüße 𝄞 €uro ";
+  }
+
+  write_units<char16_t>(in_path, text);
+  std::size_t replacements = 1;
+  EXPECT_FALSE(utf::transcode_file(in_path, out_path, utf::encoding::utf16, utf::encoding::utf8, &replacements));
+  EXPECT_EQ(read_units<char>(out_path), utf::convert_as<char>(text));
+  EXPECT_EQ(replacements, 0);
+
+  EXPECT_FALSE(utf::transcode_file(out_path, in_path, utf::encoding::utf8, utf::encoding::utf32));
+  EXPECT_TRUE(read_units<char32_t>(in_path) == utf::convert_as<char32_t>(text));
+
+  write_units<char>(in_path, "a\xFF\xE2\x82z\xF0\x9F");
+  EXPECT_FALSE(utf::transcode_file(in_path, out_path, utf::encoding::utf8, utf::encoding::utf16, &replacements));
+  EXPECT_TRUE(read_units<char16_t>(out_path) == u"a��z�");
+  EXPECT_EQ(replacements, 3);
+
+  // An odd number of bytes ends with a partial utf16 code unit.
+  write_units<char>(in_path, std::string_view("a\0b", 3));
+  EXPECT_FALSE(utf::transcode_file(in_path, out_path, utf::encoding::utf16, utf::encoding::utf8, &replacements));
+  EXPECT_EQ(read_units<char>(out_path), "a�");
+  EXPECT_EQ(replacements, 1);
+
+  write_units<char>(in_path, "");
+  EXPECT_FALSE(utf::transcode_file(in_path, out_path, utf::encoding::utf8, utf::encoding::utf16));
+  EXPECT_EQ(std::filesystem::file_size(out_path), 0);
+
+  // The output can't be the input, or a hard link to it.
+  write_units<char>(in_path, "abc");
+  EXPECT_EQ(utf::transcode_file(in_path, in_path, utf::encoding::utf8, utf::encoding::utf16),
+      std::make_error_code(std::errc::invalid_argument));
+  std::filesystem::remove(out_path);
+  std::filesystem::create_hard_link(in_path, out_path);
+  EXPECT_EQ(utf::transcode_file(in_path, out_path, utf::encoding::utf8, utf::encoding::utf16),
+      std::make_error_code(std::errc::invalid_argument));
+  EXPECT_EQ(read_units<char>(in_path), "abc");
+  std::filesystem::remove(out_path);
+
+  std::filesystem::remove(in_path);
+  EXPECT_TRUE(utf::transcode_file(in_path, out_path, utf::encoding::utf8, utf::encoding::utf16));
+  std::filesystem::remove(out_path);
+}
+} // namespace.
@@ -0,0 +1,210 @@
+#include "nano/test.h"
+#include "nano/unicode_segmentation.h"
+#include <vector>
+
+namespace {
+namespace utf = nano::unicode;
+
+template <typename CharT>
+std::vector<std::basic_string<CharT>> collect_graphemes(std::basic_string_view<CharT> str) {
+  std::vector<std::basic_string<CharT>> clusters;
+  for (utf::string_view cluster : utf::graphemes(str)) {
+    clusters.emplace_back(cluster.view<CharT>());
+  }
+  return clusters;
+}
+
+using u8_clusters = std::vector<std::string>;
+
+std::string collect_words(utf::string_view str) {
+  // Segments are joined with '|', word segments are in brackets.
+  std::string result;
+  for (const utf::word_segment& w : utf::words(str)) {
+    result += result.empty() ? "" : "|";
+    if (w.is_word) {
+      result += '[';
+      result += w.text.to_utf8_lossy();
+      result += ']';
+    }
+    else {
+      result += w.text.to_utf8_lossy();
+    }
+  }
+  return result;
+}
+
+std::string collect_lines(utf::string_view str) {
+  // Segments are joined with '|', a mandatory break is marked with '!'.
+  std::string result;
+  for (const utf::line_break_segment& line : utf::line_breaks(str)) {
+    result += result.empty() ? "" : "|";
+    result += line.text.to_utf8_lossy() + (line.is_mandatory ? "!" : "");
+  }
+  return result;
+}
+
+TEST_CASE("nano-unicode-seg", unicode_grapheme_tables) {
+  namespace detail = utf::detail;
+  using gb = detail::grapheme_break;
+  auto value = [](std::uint32_t cp) {
+    return static_cast<gb>(detail::grapheme_break_bits(cp) & detail::k_grapheme_break_mask);
+  };
+
+  EXPECT_TRUE(value('a') == gb::other);
+  EXPECT_TRUE(value('\r') == gb::cr);
+  EXPECT_TRUE(value(0x0301) == gb::extend);
+  EXPECT_TRUE(value(0x200D) == gb::zwj);
+  EXPECT_TRUE(value(0x1F1E6) == gb::regional_indicator);
+  EXPECT_TRUE(value(0x0600) == gb::prepend);
+  EXPECT_TRUE(value(0x093F) == gb::spacing_mark);
+  EXPECT_TRUE(value(0xAC00) == gb::lv);
+  EXPECT_TRUE(value(0xAC01) == gb::lvt);
+  EXPECT_TRUE(value(0xE0001) == gb::control);
+  EXPECT_TRUE(value(0x10FFFF) == gb::other);
+  EXPECT_TRUE(detail::grapheme_break_bits(0x1F600) & detail::k_grapheme_break_extended_pictographic_flag);
+  EXPECT_FALSE(detail::grapheme_break_bits('a') & detail::k_grapheme_break_extended_pictographic_flag);
+}
+
+TEST_CASE("nano-unicode-seg", unicode_graphemes) {
+  // e + combining acute, man + zwj + woman + zwj + girl, thumbs up + skin tone.
+  constexpr const char* acute = "e\u0301";
+  constexpr const char* family = "\U0001F468\u200D\U0001F469\u200D\U0001F467";
+  constexpr const char* thumbs_up = "\U0001F44D\U0001F3FD";
+
+  EXPECT_TRUE(collect_graphemes<char>("ab c") == u8_clusters({ "a", "b", " ", "c" }));
+  EXPECT_TRUE(collect_graphemes<char>("a\r\nb\n\r") == u8_clusters({ "a", "\r\n", "b", "\n", "\r" }));
+  EXPECT_TRUE(collect_graphemes<char>(std::string(acute) + "x") == u8_clusters({ acute, "x" }));
+  EXPECT_TRUE(collect_graphemes<char>("\u0600a\u0915\u093F") == u8_clusters({ "\u0600a", "\u0915\u093F" }));
+  EXPECT_TRUE(collect_graphemes<char>("\u1100\u1161\u11A8\uD55C\u11A8")
+      == u8_clusters({ "\u1100\u1161\u11A8", "\uD55C\u11A8" }));
+  EXPECT_TRUE(collect_graphemes<char>(std::string(family) + thumbs_up) == u8_clusters({ family, thumbs_up }));
+  EXPECT_TRUE(collect_graphemes<char>("\U0001F468\u200Da") == u8_clusters({ "\U0001F468\u200D", "a" }));
+  EXPECT_TRUE(collect_graphemes<char>("a\u200D\U0001F469") == u8_clusters({ "a\u200D", "\U0001F469" }));
+  EXPECT_TRUE(collect_graphemes<char>("\U0001F1EB\U0001F1F7\U0001F1E9\U0001F1EA\U0001F1FA")
+      == u8_clusters({ "\U0001F1EB\U0001F1F7", "\U0001F1E9\U0001F1EA", "\U0001F1FA" }));
+  EXPECT_TRUE(collect_graphemes<char>("\xFF\xCC\x81z") == u8_clusters({ "\xFF\xCC\x81", "z" }));
+  EXPECT_TRUE(collect_graphemes<char>("").empty());
+
+  using u16_clusters = std::vector<std::u16string>;
+  EXPECT_TRUE(collect_graphemes<char16_t>(u"e\u0301\U0001F1EB\U0001F1F7\U0001F1E9")
+      == u16_clusters({ u"e\u0301", u"\U0001F1EB\U0001F1F7", u"\U0001F1E9" }));
+
+  using u32_clusters = std::vector<std::u32string>;
+  EXPECT_TRUE(collect_graphemes<char32_t>(U"\U0001F468\u200D\U0001F469\r\n")
+      == u32_clusters({ U"\U0001F468\u200D\U0001F469", U"\r\n" }));
+
+  std::vector<std::size_t> offsets;
+  utf::grapheme_range range = utf::graphemes("ae\u0301b");
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    offsets.push_back(it.offset());
+  }
+  EXPECT_TRUE(offsets == std::vector<std::size_t>({ 0, 1, 4 }));
+  EXPECT_EQ(utf::next_grapheme_boundary("ae\u0301b", 1), 4);
+}
+
+TEST_CASE("nano-unicode-seg", unicode_truncate_to_graphemes) {
+  EXPECT_TRUE(utf::truncate_to_graphemes("e\u0301e\u0301", 6).u8view() == "e\u0301e\u0301");
+  EXPECT_TRUE(utf::truncate_to_graphemes("e\u0301e\u0301", 5).u8view() == "e\u0301");
+  EXPECT_TRUE(utf::truncate_to_graphemes("e\u0301e\u0301", 2).empty());
+  EXPECT_TRUE(utf::truncate_to_graphemes(u"\U0001F1EB\U0001F1F7\U0001F1E9\U0001F1EA", 6).u16view()
+      == u"\U0001F1EB\U0001F1F7");
+  EXPECT_TRUE(utf::truncate_to_graphemes("", 4).empty());
+}
+
+TEST_CASE("nano-unicode-seg", unicode_words) {
+  EXPECT_EQ(collect_words("Hello, world!"), "[Hello]|,| |[world]|!");
+  EXPECT_EQ(collect_words("can't stop"), "[can't]| |[stop]");
+  EXPECT_EQ(collect_words("3.14 or 1,000.5"), "[3.14]| |[or]| |[1,000.5]");
+  EXPECT_EQ(collect_words("a.b. foo_bar __"), "[a.b]|.| |[foo_bar]| |__");
+  EXPECT_EQ(collect_words("x1 2y"), "[x1]| |[2y]");
+  EXPECT_EQ(collect_words("a  \t\r\nb"), "[a]|  |\t|\r\n|[b]");
+  EXPECT_EQ(collect_words("e\u0301tude\u00A0a"), "[e\u0301tude]|\u00A0|[a]");
+  EXPECT_EQ(collect_words("\u30AB\u30BF\u30AB\u30CA\u65E5\u672C"), "[\u30AB\u30BF\u30AB\u30CA]|[\u65E5]|[\u672C]");
+  EXPECT_EQ(collect_words("\u05E6\u05D4\"\u05DC \u05D0'"), "[\u05E6\u05D4\"\u05DC]| |[\u05D0']");
+  EXPECT_EQ(collect_words("\U0001F468\u200D\U0001F469\U0001F1EB\U0001F1F7\U0001F1E9"),
+      "\U0001F468\u200D\U0001F469|\U0001F1EB\U0001F1F7|\U0001F1E9");
+  EXPECT_EQ(collect_words("a\xFF"), "[a]|\xEF\xBF\xBD");
+  EXPECT_EQ(collect_words(""), "");
+
+  EXPECT_EQ(collect_words(u"Hello, \u4E16\u754C 42."), "[Hello]|,| |[\u4E16]|[\u754C]| |[42]|.");
+  EXPECT_EQ(collect_words(U"can't"), "[can't]");
+
+  std::vector<std::size_t> offsets;
+  for (const utf::word_segment& w : utf::words(u"ab, c")) {
+    offsets.push_back(w.offset);
+  }
+  EXPECT_TRUE(offsets == std::vector<std::size_t>({ 0, 2, 3, 4 }));
+
+  bool is_word = false;
+  EXPECT_EQ(utf::next_word_boundary("one two", 3, &is_word), 4);
+  EXPECT_FALSE(is_word);
+}
+
+TEST_CASE("nano-unicode-seg", unicode_line_break_pairs) {
+  namespace detail = utf::detail;
+  using lb = detail::line_break;
+  using action = detail::line_break_action;
+  auto pair = [](lb before, lb after) {
+    return detail::k_line_break_pairs[static_cast<std::size_t>(before)][static_cast<std::size_t>(after)];
+  };
+
+  EXPECT_TRUE(pair(lb::al, lb::al) == action::indirect);
+  EXPECT_TRUE(pair(lb::al, lb::id) == action::direct);
+  EXPECT_TRUE(pair(lb::op, lb::al) == action::prohibited);
+  EXPECT_TRUE(pair(lb::al, lb::cl) == action::prohibited);
+  EXPECT_TRUE(pair(lb::cp, lb::ns) == action::prohibited);
+  EXPECT_TRUE(pair(lb::b2, lb::b2) == action::prohibited);
+  EXPECT_TRUE(pair(lb::id, lb::ns) == action::indirect);
+  EXPECT_TRUE(pair(lb::cb, lb::al) == action::direct);
+  EXPECT_TRUE(pair(lb::qu, lb::cb) == action::indirect);
+
+  auto value = [](std::uint32_t cp) {
+    return static_cast<lb>(detail::line_break_bits(cp) & detail::k_line_break_mask);
+  };
+
+  EXPECT_TRUE(value('a') == lb::al);
+  EXPECT_TRUE(value(' ') == lb::sp);
+  EXPECT_TRUE(value(0x0E01) == lb::al); // SA resolved to AL.
+  EXPECT_TRUE(value(0x0E31) == lb::cm); // SA mark resolved to CM.
+  EXPECT_TRUE(value(0x3041) == lb::ns); // CJ resolved to NS.
+  EXPECT_TRUE(value(0x10FFFF) == lb::al); // XX resolved to AL.
+  EXPECT_TRUE(detail::line_break_bits(0xFF08) & detail::k_line_break_east_asian_wide_flag);
+  EXPECT_FALSE(detail::line_break_bits('(') & detail::k_line_break_east_asian_wide_flag);
+}
+
+TEST_CASE("nano-unicode-seg", unicode_line_breaks) {
+  EXPECT_EQ(collect_lines("Hello, world! Bye."), "Hello, |world! |Bye.!");
+  EXPECT_EQ(collect_lines("a-b (c) [d] 3.14% $5 12:30"), "a-|b |(c) |[d] |3.14% |$5 |12:30!");
+  EXPECT_EQ(collect_lines("one\ntwo\r\n\r\nthree"), "one\n!|two\r\n!|\r\n!|three!");
+  EXPECT_EQ(collect_lines("a  b"), "a  |b!");
+  EXPECT_EQ(collect_lines("  a"), "  |a!");
+  EXPECT_EQ(collect_lines("( a"), "( a!");
+  EXPECT_EQ(collect_lines("a\u200Bb"), "a\u200B|b!");
+  EXPECT_EQ(collect_lines("a\u00A0b"), "a\u00A0b!");
+  EXPECT_EQ(collect_lines("\u65E5\u672C\u3002x"), "\u65E5|\u672C\u3002|x!");
+  EXPECT_EQ(collect_lines("\U0001F44D\U0001F3FDx \U0001F1EB\U0001F1F7\U0001F1E9\U0001F1EA"),
+      "\U0001F44D\U0001F3FD|x |\U0001F1EB\U0001F1F7|\U0001F1E9\U0001F1EA!");
+  EXPECT_EQ(collect_lines("\u05E9\u05DC-\u05DD"), "\u05E9\u05DC-\u05DD!");
+  EXPECT_EQ(collect_lines("a\u0301 b"), "a\u0301 |b!");
+  EXPECT_EQ(collect_lines("x(y x\uFF08y"), "x(y |x|\uFF08y!");
+  EXPECT_EQ(collect_lines(" !x"), " !|x!");
+  EXPECT_EQ(collect_lines("a\u2060 )"), "a\u2060 )!");
+  EXPECT_EQ(collect_lines("\u00A0 !b"), "\u00A0 !|b!");
+  EXPECT_EQ(collect_lines("( \u00A0x"), "( \u00A0x!");
+  EXPECT_EQ(collect_lines("a\n  !b \u2060"), "a\n!|  !|b \u2060!");
+  EXPECT_EQ(collect_lines(""), "");
+
+  EXPECT_EQ(collect_lines(u"wrap this\u2028now"), "wrap |this\u2028!|now!");
+  EXPECT_EQ(collect_lines(U"a b"), "a |b!");
+
+  std::vector<std::size_t> offsets;
+  for (const utf::line_break_segment& line : utf::line_breaks(u"ab cd ef")) {
+    offsets.push_back(line.offset);
+  }
+  EXPECT_TRUE(offsets == std::vector<std::size_t>({ 0, 3, 6 }));
+
+  bool is_mandatory = true;
+  EXPECT_EQ(utf::next_line_break("one two", 0, &is_mandatory), 4);
+  EXPECT_FALSE(is_mandatory);
+}
+} // namespace.
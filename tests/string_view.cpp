@@ -1,5 +1,7 @@
 #include "nano/test.h"
 #include "nano/unicode.h"
+#include <unordered_map>
+#include <vector>
 
 namespace {
 namespace utf = nano::unicode;
@@ -66,6 +68,499 @@ TEST_CASE("nano-unicode-sv", unicode_string_view) {
   }
 }
 
+TEST_CASE("nano-unicode-sv", unicode_string_view_lossy) {
+  std::size_t replacements = 0;
+  std::string bad = "caf\xC3";
+  utf::string_view a(bad);
+  EXPECT_TRUE(a.to_utf8_lossy(&replacements) == "caf�");
+  EXPECT_EQ(replacements, 1u);
+  EXPECT_TRUE(a.to_utf16_lossy() == u"caf�");
+  EXPECT_TRUE(a.to_utf32_lossy() == U"caf�");
+  EXPECT_TRUE(a.to_wide_lossy() == L"caf�");
+
+  utf::string_view b(getTestString());
+  EXPECT_TRUE(b.to_wide_lossy(&replacements) == getTestWString());
+  EXPECT_EQ(replacements, 0u);
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_flags) {
+  utf::string_view a(u"abcdef");
+  EXPECT_FALSE(a.known_valid());
+  EXPECT_FALSE(a.known_ascii());
+  EXPECT_FALSE(a.validate());
+  EXPECT_TRUE(a.known_valid());
+  EXPECT_TRUE(a.known_ascii());
+  EXPECT_EQ(a.count(), 6u);
+  EXPECT_TRUE(a.to_utf8() == "abcdef");
+  EXPECT_TRUE(a.to_utf32() == U"abcdef");
+
+  utf::string_view b(getTestString());
+  EXPECT_FALSE(b.validate());
+  EXPECT_TRUE(b.known_valid());
+  EXPECT_FALSE(b.known_ascii());
+  EXPECT_TRUE(b.to_wide() == getTestWString());
+
+  std::string bad = "abc\xC3";
+  utf::string_view c(bad);
+  utf::conversion_error error = c.validate();
+  EXPECT_TRUE(error.code == utf::error_code::truncated);
+  EXPECT_EQ(error.position, 3u);
+  EXPECT_FALSE(c.known_valid());
+
+  utf::string_view d(U"xyz");
+  d.set_known_ascii();
+  EXPECT_TRUE(d.known_valid());
+  EXPECT_TRUE(d.to_wide() == L"xyz");
+  EXPECT_TRUE(d.to_utf8_lossy() == "xyz");
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_layout) {
+  EXPECT_TRUE(sizeof(utf::string_view) <= 2 * sizeof(std::uint64_t));
+
+  utf::string_view a(std::u32string_view(U"abc"));
+  EXPECT_EQ(a.size(), 3u);
+  EXPECT_EQ(a.char_size(), sizeof(char32_t));
+  EXPECT_FALSE(a.null_terminated());
+  EXPECT_TRUE(a.encoding() == utf::encoding::utf32);
+
+  // Sizes past 32 bits are checked at compile time against max_size().
+  const std::uint64_t max_size = utf::string_view::max_size();
+  EXPECT_EQ(max_size, (std::min)(std::uint64_t(SIZE_MAX), (std::uint64_t(1) << 59) - 1));
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_compare) {
+  std::string s8 = getTestString();
+  std::wstring sw = getTestWString();
+  std::u32string s32 = utf::convert_as<char32_t>(s8);
+
+  EXPECT_TRUE(utf::string_view(s8) == utf::string_view(sw));
+  EXPECT_TRUE(utf::string_view(sw) == utf::string_view(s32));
+  EXPECT_EQ(utf::string_view(s8).compare(s32), 0);
+  EXPECT_FALSE(utf::string_view(s8) != utf::string_view(sw));
+
+  EXPECT_TRUE(utf::string_view("abc") < utf::string_view(u"abd"));
+  EXPECT_TRUE(utf::string_view(U"abc") < utf::string_view("abcd"));
+  EXPECT_TRUE(utf::string_view(u"abcd") > utf::string_view("abc"));
+  EXPECT_TRUE(utf::string_view("abc") != utf::string_view(U"abd"));
+  EXPECT_TRUE(utf::string_view("") == utf::string_view(U""));
+
+  // Code point order, not utf16 code unit order.
+  EXPECT_TRUE(utf::string_view(u"￿") < utf::string_view(u"\U00010000"));
+  EXPECT_TRUE(utf::string_view(u"￿") < utf::string_view("\U00010000"));
+  EXPECT_TRUE(utf::string_view("￿") < utf::string_view("\U00010000"));
+  EXPECT_TRUE(utf::string_view(U"\U00010000") > utf::string_view(u""));
+  EXPECT_TRUE(utf::string_view("café") > utf::string_view(u"cafe"));
+  EXPECT_TRUE(utf::string_view("café") <= utf::string_view(U"café"));
+  EXPECT_TRUE(utf::string_view(u"café") >= utf::string_view(U"café"));
+
+  // Ill-formed sequences are only equal to the same code units.
+  EXPECT_TRUE(utf::string_view("ab\xC3") == utf::string_view("ab\xC3"));
+  EXPECT_TRUE(utf::string_view("ab\xC3") != utf::string_view("ab\xC4"));
+  EXPECT_TRUE(utf::string_view("ab\xC3") != utf::string_view(u"ab\uFFFD"));
+  EXPECT_TRUE(utf::string_view(u"ab\uFFFD") != utf::string_view("ab\xC4"));
+  EXPECT_TRUE(utf::string_view(u"ab\uFFFD") == utf::string_view("ab\xEF\xBF\xBD"));
+
+  // The order agrees with operator== and stays transitive on ill-formed input.
+  const utf::string_view a("\xFF");
+  const utf::string_view b(u"\uFFFD");
+  const utf::string_view c("\xEF\xBF\xBD");
+  EXPECT_EQ(b.compare(c), 0);
+  EXPECT_NE(a.compare(b), 0);
+  EXPECT_NE(a.compare(c), 0);
+  EXPECT_EQ(a.compare(b), a.compare(c));
+  EXPECT_EQ(a.compare(b), -b.compare(a));
+  EXPECT_TRUE(utf::string_view("\xFF") > utf::string_view(U"\U0010FFFF"));
+  EXPECT_TRUE(utf::string_view("ab\xC3") < utf::string_view("ab\xC4"));
+  EXPECT_EQ(utf::string_view("ab\xC3").compare(utf::string_view("ab\xC3")), 0);
+
+  // Known valid strings take the code unit path, with the same order.
+  utf::string_view x("ab\xEF\xBF\xBD");
+  utf::string_view y("ab\xF0\x90\x80\x80");
+  const int order = x.compare(y);
+  EXPECT_FALSE(x.validate() || y.validate());
+  EXPECT_EQ(x.compare(y), order);
+  EXPECT_EQ(order, -1);
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_hash) {
+  std::string s8 = getTestString();
+  std::wstring sw = getTestWString();
+  std::u16string s16 = utf::convert_as<char16_t>(s8);
+  std::u32string s32 = utf::convert_as<char32_t>(s8);
+
+  EXPECT_EQ(utf::hash(s8), utf::hash(sw));
+  EXPECT_EQ(utf::hash(s8), utf::hash(s16));
+  EXPECT_EQ(utf::hash(s8), utf::hash(s32));
+  EXPECT_EQ(utf::hash("abc"), utf::hash(U"abc"));
+  EXPECT_NE(utf::hash("abc"), utf::hash(u"abd"));
+  EXPECT_EQ(utf::hash("ab\xC3"), utf::hash(u"ab�"));
+
+  std::unordered_map<std::string, int, utf::hasher, utf::equal_to> map;
+  map[s8] = 1;
+  map["key"] = 2;
+  EXPECT_EQ(map.at("key"), 2);
+
+#if defined(__cpp_lib_generic_unordered_lookup)
+  EXPECT_TRUE(map.find(s32) != map.end());
+  EXPECT_EQ(map.find(u"key")->second, 2);
+  EXPECT_TRUE(map.find(L"missing") == map.end());
+#endif
+}
+
+TEST_CASE("nano-unicode-sv", unicode_code_point_index) {
+  std::string s8 = getTestString();
+  std::u32string s32 = utf::convert_as<char32_t>(s8);
+  std::wstring sw = getTestWString();
+
+  for (std::size_t stride : { 1u, 3u, 64u }) {
+    utf::code_point_index i8(s8, stride);
+    utf::code_point_index iw(sw, stride);
+    EXPECT_EQ(i8.count(), s32.size());
+    EXPECT_EQ(iw.count(), s32.size());
+
+    bool same = true;
+    for (std::size_t i = 0; i < s32.size(); i++) {
+      same = same && i8.at(i) == s32[i] && iw.at(i) == s32[i];
+    }
+    EXPECT_TRUE(same);
+
+    EXPECT_TRUE(i8.substr_cp(5, 7) == utf::string_view(s32.substr(5, 7)));
+    EXPECT_TRUE(iw.substr_cp(100) == utf::string_view(s32.substr(100)));
+    EXPECT_TRUE(i8.substr_cp(s32.size() + 10).empty());
+    EXPECT_EQ(i8.offset(s32.size()), s8.size());
+    EXPECT_EQ(i8.at(s32.size()), 0u);
+  }
+
+  std::string bad = "a\xC3z\xE2\x82";
+  utf::code_point_index index(bad, 2);
+  EXPECT_EQ(index.count(), 4u);
+  EXPECT_EQ(index.at(1), 0xFFFDu);
+  EXPECT_EQ(index.at(2), U'z');
+  EXPECT_EQ(index.at(3), 0xFFFDu);
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_find) {
+  std::string s8 = "Yen [jɛn], Yoga [ˈjoːgɑ] 𝄞 and Yoga";
+  std::u16string s16 = utf::convert_as<char16_t>(s8);
+  utf::string_view a(s8);
+  utf::string_view b(s16);
+
+  EXPECT_EQ(a.find(u"Yoga"), s8.find("Yoga"));
+  EXPECT_EQ(b.find("Yoga"), 11u);
+  EXPECT_EQ(a.find(U"Yoga", 13), s8.rfind("Yoga"));
+  EXPECT_EQ(a.rfind(L"Yoga"), s8.rfind("Yoga"));
+  EXPECT_EQ(b.rfind(U"Yoga", 30), 11u);
+  EXPECT_EQ(a.find("Yogi"), utf::string_view::npos);
+  EXPECT_EQ(a.find(""), 0u);
+  EXPECT_EQ(b.rfind(""), s16.size());
+
+  EXPECT_TRUE(a.contains(U"ɛn]"));
+  EXPECT_TRUE(b.contains(U"𝄞"));
+  EXPECT_TRUE(b.contains("ˈjoː"));
+  EXPECT_FALSE(b.contains("Ym"));
+
+  EXPECT_TRUE(a.starts_with(u"Yen"));
+  EXPECT_TRUE(b.starts_with(U"Yen [jɛ"));
+  EXPECT_FALSE(b.starts_with("Yoga"));
+  EXPECT_TRUE(a.ends_with(L"and Yoga"));
+  EXPECT_TRUE(b.ends_with("Yoga"));
+  EXPECT_FALSE(a.ends_with(u"Yen"));
+  EXPECT_FALSE(a.starts_with(U"Yen [jɛn], Yoga [ˈjoːgɑ] 𝄞 and Yoga!"));
+
+  // Matches must not split a code point.
+  std::u16string pair = u"x𝄞";
+  utf::string_view c(pair);
+  EXPECT_EQ(c.find(std::u16string(1, pair[1])), utf::string_view::npos);
+  EXPECT_EQ(c.find(std::u16string(1, pair[2])), utf::string_view::npos);
+  EXPECT_FALSE(c.ends_with(std::u16string(1, pair[2])));
+  EXPECT_EQ(utf::string_view("é").find("\xC3"), utf::string_view::npos);
+  EXPECT_FALSE(utf::string_view("é").starts_with("\xC3"));
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_visit) {
+  utf::string_view a(u"abc");
+  EXPECT_EQ(a.visit([](auto str) { return sizeof(typename decltype(str)::value_type); }), sizeof(char16_t));
+  EXPECT_TRUE(a.visit([](auto str) { return std::u16string(str.begin(), str.end()); }) == u"abc");
+
+  std::size_t total = 0;
+  utf::string_view(U"abcd").visit([&](auto str) { total += str.size(); });
+  EXPECT_EQ(total, 4u);
+
+  auto same_type = [](auto x, auto y) { return std::is_same_v<decltype(x), decltype(y)>; };
+  EXPECT_TRUE(utf::visit(same_type, utf::string_view(L"a"), utf::string_view(L"b")));
+  EXPECT_FALSE(utf::visit(same_type, utf::string_view("a"), utf::string_view(U"b")));
+  auto total_size = [](auto x, auto y) { return x.size() + y.size(); };
+  EXPECT_EQ(utf::visit(total_size, utf::string_view("ab"), utf::string_view(u"c")), 3u);
+}
+
+TEST_CASE("nano-unicode-sv", unicode_string_view_split) {
+  auto collect = [](utf::split_range range) {
+    std::vector<std::u32string> pieces;
+    for (utf::string_view piece : range) {
+      pieces.push_back(piece.to_utf32());
+    }
+    return pieces;
+  };
+
+  using pieces = std::vector<std::u32string>;
+  EXPECT_TRUE(collect(utf::string_view("a,b,,c").split(U',')) == pieces({ U"a", U"b", U"", U"c" }));
+  EXPECT_TRUE(collect(utf::string_view(u"a,").split(U',')) == pieces({ U"a", U"" }));
+  EXPECT_TRUE(collect(utf::string_view("").split(U',')) == pieces({ U"" }));
+  EXPECT_TRUE(collect(utf::string_view("abc").split(U',')) == pieces({ U"abc" }));
+
+  // Multi-unit delimiters.
+  std::string s8 = "Yen→Yoga→ɛ→𝄞";
+  EXPECT_TRUE(collect(utf::string_view(s8).split(U'→')) == pieces({ U"Yen", U"Yoga", U"ɛ", U"𝄞" }));
+  EXPECT_TRUE(collect(utf::string_view(u"a𝄞b𝄞").split(U'𝄞')) == pieces({ U"a", U"b", U"" }));
+  EXPECT_TRUE(collect(utf::string_view("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa;b").split(U';'))
+      == pieces({ U"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", U"b" }));
+
+  std::string text = "one\r\ntwo\nthree\rfour five \nsix\n";
+  EXPECT_TRUE(collect(utf::string_view(text).lines())
+      == pieces({ U"one", U"two", U"three", U"four", U"five", U"", U"six" }));
+  std::u16string text16 = utf::convert_as<char16_t>(text);
+  EXPECT_TRUE(collect(utf::string_view(text16).lines())
+      == pieces({ U"one", U"two", U"three", U"four", U"five", U"", U"six" }));
+  EXPECT_TRUE(collect(utf::string_view(U"a\n\nb").lines()) == pieces({ U"a", U"", U"b" }));
+  EXPECT_TRUE(collect(utf::string_view("").lines()).empty());
+
+  EXPECT_TRUE(collect(utf::string_view("a b\tc→d").split_any(U" \t→")) == pieces({ U"a", U"b", U"c", U"d" }));
+  EXPECT_TRUE(collect(utf::string_view(L"a1b2c").split_any("0123456789")) == pieces({ U"a", U"b", U"c" }));
+  EXPECT_TRUE(collect(utf::string_view(u"a1b→cαdz").split_any(U"0123456789→αβγδεζηθz"))
+      == pieces({ U"a", U"b", U"c", U"d", U"" }));
+
+  std::string ascii = "x:y";
+  utf::string_view known(ascii);
+  known.set_known_ascii();
+  utf::split_range range = known.split(U':');
+  auto it = range.begin();
+  EXPECT_TRUE((*it).known_ascii());
+  EXPECT_TRUE(*++it == utf::string_view("y"));
+  EXPECT_TRUE(++it == range.end());
+}
+
+TEST_CASE("nano-unicode-sv", unicode_truncate_to_units) {
+  std::string s8 = "ab€𝄞c"; // 1 + 1 + 3 + 4 + 1 bytes.
+  utf::string_view a(s8);
+  EXPECT_TRUE(utf::truncate_to_units(a, 100) == a);
+  EXPECT_TRUE(utf::truncate_to_units(a, 2) == utf::string_view("ab"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 4) == utf::string_view("ab"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 5) == utf::string_view("ab€"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 8) == utf::string_view("ab€"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 9) == utf::string_view("ab€𝄞"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 0).empty());
+
+  std::u16string s16 = u"ab𝄞c";
+  utf::string_view b(s16);
+  EXPECT_TRUE(utf::truncate_to_units(b, 3) == utf::string_view("ab"));
+  EXPECT_TRUE(utf::truncate_to_units(b, 4) == utf::string_view("ab𝄞"));
+
+  // Budget in another encoding.
+  EXPECT_TRUE(utf::truncate_to_units(b, 5, utf::encoding::utf8) == utf::string_view("ab"));
+  EXPECT_TRUE(utf::truncate_to_units(b, 6, utf::encoding::utf8) == utf::string_view("ab𝄞"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 4, utf::encoding::utf16) == utf::string_view("ab€"));
+  EXPECT_TRUE(utf::truncate_to_units(a, 4, utf::encoding::utf32) == utf::string_view("ab€𝄞"));
+  EXPECT_TRUE(utf::truncate_to_units(utf::string_view(U"€€"), 5, utf::encoding::utf8) == utf::string_view("€"));
+}
+
+TEST_CASE("nano-unicode-sv", unicode_chunks) {
+  auto collect = [](utf::chunk_range range) {
+    std::vector<std::u32string> pieces;
+    for (utf::string_view piece : range) {
+      pieces.push_back(piece.to_utf32());
+    }
+    return pieces;
+  };
+
+  using pieces = std::vector<std::u32string>;
+  EXPECT_TRUE(collect(utf::chunks("ab€𝄞c", 4)) == pieces({ U"ab", U"€", U"𝄞", U"c" }));
+  EXPECT_TRUE(collect(utf::chunks("ab€𝄞c", 5)) == pieces({ U"ab€", U"𝄞c" }));
+  EXPECT_TRUE(collect(utf::chunks(u"ab𝄞c", 1)) == pieces({ U"a", U"b", U"𝄞", U"c" }));
+  EXPECT_TRUE(collect(utf::chunks(U"abcde", 2, utf::encoding::utf8)) == pieces({ U"ab", U"cd", U"e" }));
+  EXPECT_TRUE(collect(utf::chunks("", 4)).empty());
+
+  std::string text = getTestString();
+  std::size_t total = 0;
+  bool fits = true;
+  for (utf::string_view chunk : utf::chunks(text, 7)) {
+    fits = fits && chunk.size() <= 7 && !chunk.empty() && !chunk.validate();
+    total += chunk.size();
+  }
+  EXPECT_TRUE(fits);
+  EXPECT_EQ(total, text.size());
+}
+
+TEST_CASE("nano-unicode-sv", unicode_code_points) {
+  std::string str = "a€𝄞";
+  std::u32string out;
+  for (char32_t c : utf::code_points(str)) {
+    out.push_back(c);
+  }
+  EXPECT_TRUE(out == U"a€𝄞");
+
+  out.clear();
+  for (char32_t c : utf::code_points(std::u16string_view(u"a€𝄞"))) {
+    out.push_back(c);
+  }
+  EXPECT_TRUE(out == U"a€𝄞");
+
+  out.clear();
+  for (char32_t c : utf::code_points(utf::string_view("a\xFF\xE2\x82z"))) {
+    out.push_back(c);
+  }
+  EXPECT_TRUE(out == U"a��z");
+
+  utf::string_view wide(L"x€y");
+  std::vector<std::size_t> offsets;
+  out.clear();
+  for (auto it = utf::code_points(wide).begin(); it != utf::code_points(wide).end(); ++it) {
+    out.push_back(*it);
+    offsets.push_back(it.offset());
+  }
+  EXPECT_TRUE(out == U"x€y");
+  EXPECT_TRUE(offsets == std::vector<std::size_t>({ 0, 1, 2 }));
+
+  std::string text = getTestString();
+  std::size_t count = 0;
+  for (char32_t c : utf::code_points(utf::string_view(text))) {
+    count += c != 0;
+  }
+  EXPECT_EQ(count, utf::string_view(text).count());
+  EXPECT_TRUE(utf::code_points(std::string_view()).begin() == utf::code_points(std::string_view()).end());
+}
+
+TEST_CASE("nano-unicode-sv", unicode_decode_blocks) {
+  std::string str = "ab€𝄞c\xFF" "d";
+  std::vector<std::u32string> blocks;
+  std::vector<std::size_t> offsets;
+  for (const auto& b : utf::decode_blocks<char32_t>(str, 3)) {
+    blocks.emplace_back(b.units());
+    offsets.insert(offsets.end(), b.offsets(), b.offsets() + b.size());
+  }
+  offsets.push_back(str.size());
+  EXPECT_TRUE(blocks == std::vector<std::u32string>({ U"ab€", U"𝄞c�", U"d" }));
+  EXPECT_TRUE(offsets == std::vector<std::size_t>({ 0, 1, 2, 5, 9, 10, 11, 12 }));
+
+  std::u16string units;
+  std::size_t code_points = 0;
+  for (const auto& b : utf::decode_blocks<char16_t>(U"a𝄞€")) {
+    units.append(b.units());
+    code_points += b.size();
+    EXPECT_EQ(b.offset(b.size()), 3);
+  }
+  EXPECT_TRUE(units == u"a𝄞€");
+  EXPECT_EQ(code_points, 3);
+
+  std::string text = getTestString();
+  std::u32string decoded;
+  for (const auto& b : utf::decode_blocks(text)) {
+    EXPECT_TRUE(b.size() <= 64 && b.size() > 0);
+    decoded.append(b.units());
+  }
+  EXPECT_TRUE(decoded == utf::string_view(text).to_utf32());
+
+  auto empty = utf::decode_blocks<char>(std::string_view());
+  EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+template <typename CharT>
+std::string to_bytes(std::basic_string_view<CharT> str, bool big_endian) {
+  std::string bytes;
+  for (CharT c : str) {
+    for (std::size_t k = 0; k < sizeof(CharT); k++) {
+      const std::size_t shift = 8 * (big_endian ? sizeof(CharT) - 1 - k : k);
+      bytes.push_back(static_cast<char>((static_cast<std::uint32_t>(c) >> shift) & 0xFF));
+    }
+  }
+  return bytes;
+}
+
+TEST_CASE("nano-unicode-sv", unicode_detect_encoding) {
+  std::string text = getTestString();
+  std::u16string u16 = utf::convert_as<char16_t>(text);
+  std::u32string u32 = utf::convert_as<char32_t>(text);
+
+  std::string bytes = "\xEF\xBB\xBF" + text;
+  utf::encoding_detection d = utf::detect_encoding(bytes);
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.has_bom && d.confidence == 1);
+  EXPECT_EQ(d.payload.u8view(), text);
+
+  bytes = "\xFF\xFE" + to_bytes<char16_t>(u16, false);
+  d = utf::detect_encoding(bytes);
+  EXPECT_TRUE(d.encoding == utf::encoding::utf16 && !d.big_endian && d.has_bom && d.confidence == 1);
+  EXPECT_EQ(d.bytes.size(), u16.size() * 2);
+  EXPECT_EQ(d.bytes.data(), bytes.data() + 2);
+
+  d = utf::detect_encoding("\xFE\xFF" + to_bytes<char16_t>(u16, true));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf16 && d.big_endian && d.has_bom);
+
+  d = utf::detect_encoding(std::string("\xFF\xFE\0\0", 4) + to_bytes<char32_t>(u32, false));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf32 && !d.big_endian && d.has_bom);
+
+  d = utf::detect_encoding(std::string("\0\0\xFE\xFF", 4) + to_bytes<char32_t>(u32, true));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf32 && d.big_endian && d.has_bom);
+
+  // Without a byte order mark.
+  d = utf::detect_encoding(text);
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && !d.has_bom && d.confidence > 0.5f);
+  EXPECT_EQ(d.payload.size(), text.size());
+
+  d = utf::detect_encoding(std::string_view(text).substr(0, text.find("€") + 1));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.confidence > 0.5f);
+
+  d = utf::detect_encoding("caf\xE9 cr\xE8me");
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.confidence < 0.5f);
+
+  d = utf::detect_encoding("caf\xE9 cr\xE8me br\xFBl\xE9" "e");
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.confidence < 0.5f);
+
+  // A stray zero byte doesn't make utf16, the trailing bytes are counted.
+  d = utf::detect_encoding(std::string_view("one\0two three", 13));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.confidence > 0.5f);
+
+  d = utf::detect_encoding(std::string_view("a\0", 2));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf16 && !d.big_endian && d.confidence > 0.5f);
+
+  d = utf::detect_encoding(std::string_view("\0a\0b\0", 5));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8);
+
+  // A lone surrogate isn't utf16.
+  d = utf::detect_encoding(std::string_view("a\0\x00\xDC" "b\0c\0", 8));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8);
+
+  // Utf16 without zero bytes.
+  const std::u16string cjk = u"\u65E5\u672C\u8A9E\u306E\u30C6\u30AD\u30B9\u30C8\u3002\uD55C\uAD6D\uC5B4";
+
+  for (bool big_endian : { false, true }) {
+    d = utf::detect_encoding(to_bytes<char16_t>(u16, big_endian));
+    EXPECT_TRUE(d.encoding == utf::encoding::utf16 && d.big_endian == big_endian && !d.has_bom);
+    EXPECT_TRUE(d.confidence > 0.5f);
+
+    d = utf::detect_encoding(to_bytes<char32_t>(u32, big_endian));
+    EXPECT_TRUE(d.encoding == utf::encoding::utf32 && d.big_endian == big_endian && d.confidence > 0.5f);
+
+    bytes = to_bytes<char16_t>(cjk, big_endian);
+    d = utf::detect_encoding(bytes);
+    EXPECT_TRUE(d.encoding == utf::encoding::utf16 && d.big_endian == big_endian && !d.has_bom);
+  }
+
+  // The payload is only a view in native byte order.
+  const char16_t one = 1;
+  const bool little_endian = *reinterpret_cast<const char*>(&one) == 1;
+  std::u16string aligned = u"\uFEFFhello";
+  d = utf::detect_encoding(std::string_view(reinterpret_cast<const char*>(aligned.data()), aligned.size() * 2));
+  EXPECT_TRUE(d.encoding == utf::encoding::utf16 && d.big_endian != little_endian);
+  EXPECT_TRUE(d.payload.u16view() == u"hello");
+  EXPECT_EQ(d.payload.u16data(), aligned.data() + 1);
+
+  bytes = to_bytes<char16_t>(u"hello", little_endian);
+  d = utf::detect_encoding(bytes);
+  EXPECT_TRUE(d.encoding == utf::encoding::utf16 && d.payload.empty() && d.bytes.size() == 10);
+
+  d = utf::detect_encoding("");
+  EXPECT_TRUE(d.encoding == utf::encoding::utf8 && d.confidence == 0);
+}
+
 inline constexpr const char* ss = R"(Original by Markus Kuhn, adapted for HTML by Martin Dürst.
 
 UTF-8 encoded sample plain-text file
@@ -0,0 +1,220 @@
+#!/usr/bin/env perl
+#
+# Generates nano/unicode_tables.h from the Unicode character database shipped with perl.
+#
+#   perl tools/generate_unicode_tables.pl > nano/unicode_tables.h
+#
+# Each property is stored as a two-stage table: stage1[cp >> shift] is the index of a
+# block of stage2 holding the values of the (1 << shift) code points of that block.
+# Identical blocks are stored once, the shift giving the smallest tables is picked.
+#
+use strict;
+use warnings;
+use Unicode::UCD qw(prop_invlist);
+
+my @properties = (
+  {
+    name => 'grapheme_break',
+    description => 'Grapheme_Cluster_Break (UAX #29), with the Extended_Pictographic flag',
+    property => 'GCB',
+    values => [qw(Other CR LF Control Extend ZWJ Regional_Indicator Prepend SpacingMark L V T LV LVT)],
+    flags => [ [ ['Extended_Pictographic'], 'extended_pictographic', 0x80 ] ],
+  },
+  {
+    name => 'word_break',
+    description => 'Word_Break (UAX #29), with a flag for the letters and numbers (Alphabetic or gc=N)',
+    property => 'WB',
+    values => [qw(Other CR LF Newline Extend ZWJ Regional_Indicator Format Katakana Hebrew_Letter ALetter
+      Single_Quote Double_Quote MidNumLet MidLetter MidNum Numeric ExtendNumLet WSegSpace)],
+    flags => [ [ ['Alphabetic', 'gc=N'], 'word_character', 0x80 ] ],
+  },
+  {
+    name => 'line_break',
+    description => 'Line_Break (UAX #14) resolved by LB1, with the flags used by LB30 and LB30b',
+    property => 'LB',
+    values => [qw(AL BK CR LF CM NL WJ ZW GL SP ZWJ B2 BA BB HY CB CL CP EX IN NS OP QU IS NU PO PR SY
+      EB EM H2 H3 HL ID JL JT JV RI)],
+
+    # LB1: AI, SG and XX are resolved to AL (the first value), CJ to NS, and SA to CM for the marks
+    # (gc=Mn or gc=Mc) and to AL otherwise.
+    aliases => [ [ 'LB=CJ', 'NS' ], [ 'LB=SA', 'CM', [ 'gc=Mn', 'gc=Mc' ] ] ],
+
+    flags => [
+      [ [ 'ea=F', 'ea=W', 'ea=H' ], 'east_asian_wide', 0x80, [ 'LB=OP', 'LB=CP' ] ],
+      [ ['Extended_Pictographic'], 'unassigned_pictographic', 0x40, ['gc=Cn'] ],
+    ],
+  },
+);
+
+sub snake_case {
+  my ($name) = @_;
+  $name =~ s/([a-z])([A-Z])/$1_$2/g;
+  return lc($name);
+}
+
+# Returns a list where the code points of any of the properties are set.
+sub code_point_set {
+  my @set = (0) x 0x110000;
+
+  for my $property (@_) {
+    my @list = prop_invlist($property);
+    die "Unknown property $property\n" unless @list;
+    push @list, 0x110000 if @list % 2;
+
+    for (my $i = 0; $i < @list; $i += 2) {
+      $set[$_] = 1 for $list[$i] .. $list[$i + 1] - 1;
+    }
+  }
+
+  return \@set;
+}
+
+sub property_values {
+  my ($p) = @_;
+  my @values = (0) x 0x110000;
+  my %index_of = map { $p->{values}[$_] => $_ } 0 .. $#{ $p->{values} };
+
+  for my $index (1 .. $#{ $p->{values} }) {
+    my @list = prop_invlist("$p->{property}=$p->{values}[$index]");
+    die "Unknown value $p->{property}=$p->{values}[$index]\n" unless @list;
+    push @list, 0x110000 if @list % 2;
+
+    for (my $i = 0; $i < @list; $i += 2) {
+      $values[$_] = $index for $list[$i] .. $list[$i + 1] - 1;
+    }
+  }
+
+  # [property, value, only the code points of these properties].
+  for my $alias (@{ $p->{aliases} || [] }) {
+    my $set = code_point_set($alias->[0]);
+    my $only = $alias->[2] ? code_point_set(@{ $alias->[2] }) : undef;
+
+    for my $cp (0 .. 0x10FFFF) {
+      $values[$cp] = $index_of{ $alias->[1] } if $set->[$cp] && (!$only || $only->[$cp]);
+    }
+  }
+
+  # [properties, name, bit, only the code points of these properties].
+  for my $flag (@{ $p->{flags} || [] }) {
+    my $set = code_point_set(@{ $flag->[0] });
+    my $only = $flag->[3] ? code_point_set(@{ $flag->[3] }) : undef;
+
+    for my $cp (0 .. 0x10FFFF) {
+      $values[$cp] |= $flag->[2] if $set->[$cp] && (!$only || $only->[$cp]);
+    }
+  }
+
+  return \@values;
+}
+
+sub compress {
+  my ($values) = @_;
+  my $last = 0x10FFFF;
+  $last-- while $last > 0 && $values->[$last] == 0;
+
+  my $best;
+  for my $shift (4 .. 10) {
+    my $block_size = 1 << $shift;
+    my $limit = (($last >> $shift) + 1) << $shift;
+    my (%blocks, @stage1, @stage2);
+
+    for (my $start = 0; $start < $limit; $start += $block_size) {
+      my $key = join(',', @{$values}[$start .. $start + $block_size - 1]);
+
+      if (!exists $blocks{$key}) {
+        $blocks{$key} = scalar(@stage2) >> $shift;
+        push @stage2, @{$values}[$start .. $start + $block_size - 1];
+      }
+
+      push @stage1, $blocks{$key};
+    }
+
+    my $index_size = (@stage2 >> $shift) <= 256 ? 1 : 2;
+    my $size = @stage1 * $index_size + @stage2;
+
+    if (!$best || $size < $best->{size}) {
+      $best = { shift => $shift, limit => $limit, stage1 => \@stage1, stage2 => \@stage2,
+        index_type => $index_size == 1 ? 'std::uint8_t' : 'std::uint16_t', size => $size };
+    }
+  }
+
+  return $best;
+}
+
+sub print_array {
+  my ($type, $name, $values) = @_;
+  print "  inline constexpr $type $name\[] = {\n";
+
+  my $line = '    ';
+  for my $value (@$values) {
+    if (length($line) + length($value) + 1 > 120) {
+      print "$line\n";
+      $line = '    ';
+    }
+
+    $line .= "$value,";
+  }
+
+  print "$line\n  };\n\n";
+}
+
+my $version = Unicode::UCD::UnicodeVersion();
+
+print <<"HEADER";
+///
+/// Generated by tools/generate_unicode_tables.pl from the Unicode $version character database.
+/// Do not edit.
+///
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// clang-format off
+namespace nano::unicode::detail {
+  inline constexpr const char* k_unicode_tables_version = "$version";
+
+HEADER
+
+for my $p (@properties) {
+  my $table = compress(property_values($p));
+  my $name = $p->{name};
+  my $mask = (1 << $table->{shift}) - 1;
+
+  print "  /// $p->{description}.\n";
+  print "  enum class $name : std::uint8_t {\n";
+  print '    ', snake_case($p->{values}[$_]), ",\n" for 0 .. $#{ $p->{values} };
+  print "  };\n\n";
+  printf "  inline constexpr std::size_t k_%s_count = %d;\n\n", $name, scalar(@{ $p->{values} });
+
+  if ($p->{flags}) {
+    my $mask = 0xFF;
+
+    for my $flag (@{ $p->{flags} }) {
+      printf "  inline constexpr std::uint8_t k_%s_%s_flag = 0x%02X;\n", $name, $flag->[1], $flag->[2];
+      $mask &= ~$flag->[2];
+    }
+
+    printf "  inline constexpr std::uint8_t k_%s_mask = 0x%02X;\n\n", $name, $mask;
+  }
+
+  printf "  inline constexpr std::uint32_t k_%s_shift = %d;\n", $name, $table->{shift};
+  printf "  inline constexpr std::uint32_t k_%s_limit = 0x%X;\n\n", $name, $table->{limit};
+  print_array($table->{index_type}, "k_${name}_stage1", $table->{stage1});
+  print_array('std::uint8_t', "k_${name}_stage2", $table->{stage2});
+
+  print "  /// Returns the $name value of cp";
+  print " with its flags" if $p->{flags};
+  print ".\n";
+  print "  inline constexpr std::uint8_t ${name}_bits(std::uint32_t cp) noexcept {\n";
+  print "    if (cp >= k_${name}_limit) {\n      return 0;\n    }\n\n";
+  print "    const std::size_t block = static_cast<std::size_t>(k_${name}_stage1[cp >> k_${name}_shift]);\n";
+  printf "    return k_%s_stage2[(block << k_%s_shift) | (cp & 0x%X)];\n", $name, $name, $mask;
+  print "  }\n\n";
+}
+
+print <<'FOOTER';
+} // namespace nano::unicode::detail.
+// clang-format on
+FOOTER
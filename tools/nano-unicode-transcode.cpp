@@ -0,0 +1,50 @@
+///
+/// nano-unicode-transcode: converts a file between utf8, utf16 and utf32 (native byte order).
+///
+/// Usage: nano-unicode-transcode <from> <to> <input> <output>
+///
+
+#include "nano/unicode_file.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+bool parse_encoding(const char* name, nano::unicode::encoding& enc) {
+  if (std::strcmp(name, "utf8") == 0) {
+    enc = nano::unicode::encoding::utf8;
+  }
+  else if (std::strcmp(name, "utf16") == 0) {
+    enc = nano::unicode::encoding::utf16;
+  }
+  else if (std::strcmp(name, "utf32") == 0) {
+    enc = nano::unicode::encoding::utf32;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+} // namespace.
+
+int main(int argc, const char* argv[]) {
+  nano::unicode::encoding from;
+  nano::unicode::encoding to;
+
+  if (argc != 5 || !parse_encoding(argv[1], from) || !parse_encoding(argv[2], to)) {
+    std::fprintf(stderr, "usage: %s <utf8|utf16|utf32> <utf8|utf16|utf32> <input> <output>\n", argv[0]);
+    return 2;
+  }
+
+  std::size_t replacements = 0;
+  if (std::error_code error = nano::unicode::transcode_file(argv[3], argv[4], from, to, &replacements)) {
+    std::fprintf(stderr, "%s: %s\n", argv[0], error.message().c_str());
+    return 1;
+  }
+
+  if (replacements) {
+    std::fprintf(stderr, "%s: %zu ill-formed sequences replaced with U+FFFD\n", argv[0], replacements);
+  }
+
+  return 0;
+}